@@ -0,0 +1,203 @@
+// one bit per map cell, every row of the map is a single 32bit word (bit x = column x)
+// so maps up to 32 cells wide are supported (15x15, 31x31 ...)
+#define BITBOARD_ROW_MASK (0xFFFFFFFF >> (32 - MAP_WIDTH))
+
+// neighbour counts (0 ... 4) are kept as 3 bit planes (1, 2 and 4)
+#define BITBOARD_COUNT_PLANES 3
+
+typedef struct Bitboard
+{
+    unsigned long row[MAP_HEIGHT];
+} Bitboard;
+
+int popcount32(unsigned long v)
+{
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    v = (v + (v >> 4)) & 0x0F0F0F0F;
+    return (v * 0x01010101) >> 24;
+}
+
+void bitboard_clear(Bitboard *board)
+{
+    if (!board)
+        return;
+
+    memset(board, 0, sizeof(Bitboard));
+}
+
+void bitboard_copy(Bitboard *dest, Bitboard *src)
+{
+    if (!dest || !src)
+        return;
+
+    memcpy(dest, src, sizeof(Bitboard));
+}
+
+void bitboard_set(Bitboard *board, int x, int y)
+{
+    board->row[y] |= 1 << x;
+}
+
+void bitboard_unset(Bitboard *board, int x, int y)
+{
+    board->row[y] &= ~(1 << x);
+}
+
+int bitboard_test(Bitboard *board, int x, int y)
+{
+    return (board->row[y] >> x) & 1;
+}
+
+int bitboard_popcount(Bitboard *board)
+{
+    int y = 0, counter = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        counter += popcount32(board->row[y]);
+
+    return counter;
+}
+
+// dest = a & ~b
+void bitboard_and_not(Bitboard *dest, Bitboard *a, Bitboard *b)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        dest->row[y] = a->row[y] & ~b->row[y];
+}
+
+// dest = a & b
+void bitboard_and(Bitboard *dest, Bitboard *a, Bitboard *b)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        dest->row[y] = a->row[y] & b->row[y];
+}
+
+// dest = a | b
+void bitboard_or(Bitboard *dest, Bitboard *a, Bitboard *b)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        dest->row[y] = a->row[y] | b->row[y];
+}
+
+// dest = cells that aren't set in the board
+void bitboard_not(Bitboard *dest, Bitboard *board)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        dest->row[y] = ~board->row[y] & BITBOARD_ROW_MASK;
+}
+
+// counts set neighbours of every cell at once, cells outside of the map count as 'outside' (true or false)
+// result is written into planes[0] (1), planes[1] (2) and planes[2] (4)
+void bitboard_neighbour_counts(Bitboard *board, int outside, Bitboard *planes)
+{
+    unsigned long border = 0;
+    if (outside)
+        border = BITBOARD_ROW_MASK;
+
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        unsigned long neighbour[CARDINAL_DIRECTIONS];
+
+        neighbour[CARDINAL_TOP] = border;
+        if (y > 0)
+            neighbour[CARDINAL_TOP] = board->row[y - 1];
+
+        neighbour[CARDINAL_BOTTOM] = border;
+        if (y < MAP_HEIGHT - 1)
+            neighbour[CARDINAL_BOTTOM] = board->row[y + 1];
+
+        neighbour[CARDINAL_RIGHT] = board->row[y] >> 1;
+        neighbour[CARDINAL_LEFT] = (board->row[y] << 1) & BITBOARD_ROW_MASK;
+        if (outside)
+        {
+            neighbour[CARDINAL_RIGHT] |= 1 << (MAP_WIDTH - 1);
+            neighbour[CARDINAL_LEFT] |= 1;
+        }
+
+        // bit sliced adder, one lane per column
+        unsigned long ones = 0, twos = 0, fours = 0;
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            unsigned long carry = ones & neighbour[n];
+            ones ^= neighbour[n];
+            fours |= twos & carry;
+            twos ^= carry;
+        }
+
+        planes[0].row[y] = ones;
+        planes[1].row[y] = twos;
+        planes[2].row[y] = fours;
+    }
+}
+
+// dest = cells with at least one set neighbour (outside of the map never counts)
+void bitboard_dilate(Bitboard *dest, Bitboard *board)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        unsigned long cells = (board->row[y] >> 1) | ((board->row[y] << 1) & BITBOARD_ROW_MASK);
+        if (y > 0)
+            cells |= board->row[y - 1];
+
+        if (y < MAP_HEIGHT - 1)
+            cells |= board->row[y + 1];
+
+        dest->row[y] = cells;
+    }
+}
+
+// dest = cells with at least two counted neighbours
+void bitboard_count_at_least_two(Bitboard *dest, Bitboard *planes)
+{
+    bitboard_or(dest, &planes[1], &planes[2]);
+}
+
+// dest = cells with exactly one counted neighbour
+void bitboard_count_exactly_one(Bitboard *dest, Bitboard *planes)
+{
+    int y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        dest->row[y] = planes[0].row[y] & ~planes[1].row[y] & ~planes[2].row[y];
+}
+
+// returns neighbour count of the given cell from the bit planes
+int bitboard_count_at(Bitboard *planes, int x, int y)
+{
+    return bitboard_test(&planes[0], x, y) | (bitboard_test(&planes[1], x, y) << 1) | (bitboard_test(&planes[2], x, y) << 2);
+}
+
+// returns amount of set neighbours of a single cell, cells outside of the map count as 'outside'
+int bitboard_neighbours_at(Bitboard *board, int x, int y, int outside)
+{
+    int counter = 0;
+
+    if (y > 0)
+        counter += bitboard_test(board, x, y - 1);
+    else
+        counter += outside;
+
+    if (y < MAP_HEIGHT - 1)
+        counter += bitboard_test(board, x, y + 1);
+    else
+        counter += outside;
+
+    if (x > 0)
+        counter += bitboard_test(board, x - 1, y);
+    else
+        counter += outside;
+
+    if (x < MAP_WIDTH - 1)
+        counter += bitboard_test(board, x + 1, y);
+    else
+        counter += outside;
+
+    return counter;
+}
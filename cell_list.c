@@ -0,0 +1,68 @@
+// list of map cells (cell = x + y * MAP_WIDTH) with a fixed capacity of one entry per cell
+// cells are 16bit, lists hold no pointers, so they can be copied with memcpy and written to a file as they are
+#define CELL_LIST_CAPACITY (MAP_WIDTH * MAP_HEIGHT)
+
+typedef struct CellList
+{
+    int size;
+    short cells[CELL_LIST_CAPACITY];
+} CellList;
+
+void cell_list_clear(CellList *list)
+{
+    if (!list)
+        return;
+
+    list->size = 0;
+}
+
+void cell_list_copy(CellList *dest, CellList *src)
+{
+    if (!dest || !src)
+        return;
+
+    dest->size = src->size;
+    memcpy(dest->cells, src->cells, sizeof(short) * src->size);
+}
+
+// returns false if list is full already
+int cell_list_add(CellList *list, int cell)
+{
+    if (!list)
+        return false;
+
+    if (list->size >= CELL_LIST_CAPACITY)
+        return false;
+
+    list->cells[list->size] = cell;
+    list->size++;
+    return true;
+}
+
+int cell_list_size(CellList *list)
+{
+    if (!list)
+        return 0;
+
+    return list->size;
+}
+
+// returns -1 if index is out of range
+int cell_list_get_at(CellList *list, int index)
+{
+    if (!list)
+        return -1;
+
+    if (index < 0 || index >= list->size)
+        return -1;
+
+    return list->cells[index];
+}
+
+int cell_list_last(CellList *list)
+{
+    if (!list)
+        return -1;
+
+    return cell_list_get_at(list, list->size - 1);
+}
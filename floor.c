@@ -0,0 +1,278 @@
+#define FLOOR_CELLS (MAP_WIDTH * MAP_HEIGHT)
+
+// door bits, same order as cardinal directions (1 << CARDINAL_*)
+#define DOOR_TOP 1
+#define DOOR_RIGHT 2
+#define DOOR_BOTTOM 4
+#define DOOR_LEFT 8
+
+// secret doors are stored in the high nibble of the doors byte
+#define DOOR_SECRET_SHIFT 4
+
+// compact copy of a generated floor, cells are stored as x + y * MAP_WIDTH
+typedef struct Floor
+{
+    int seed;
+    int level_id;
+    int attempts;
+
+    int max_rooms;
+    int rooms;
+    int max_secrets;
+    int secrets;
+    int max_item_rooms;
+    int item_rooms;
+    int end_rooms;
+
+    unsigned char type[FLOOR_CELLS];
+    unsigned char doors[FLOOR_CELLS];
+    unsigned char secret_chance[FLOOR_CELLS];
+    short region[FLOOR_CELLS];
+
+    // cells of the same room, stored the same way as doors (see Tile's links)
+    unsigned char links[FLOOR_CELLS];
+} Floor;
+
+int floor_cell(int x, int y)
+{
+    return x + y * MAP_WIDTH;
+}
+
+int tile_door_mask(Tile *tile)
+{
+    if (!tile)
+        return 0;
+
+    int mask = 0;
+    if (tile->top)
+        mask |= DOOR_TOP;
+    if (tile->right)
+        mask |= DOOR_RIGHT;
+    if (tile->bottom)
+        mask |= DOOR_BOTTOM;
+    if (tile->left)
+        mask |= DOOR_LEFT;
+
+    if (tile->secret_top)
+        mask |= DOOR_TOP << DOOR_SECRET_SHIFT;
+    if (tile->secret_right)
+        mask |= DOOR_RIGHT << DOOR_SECRET_SHIFT;
+    if (tile->secret_bottom)
+        mask |= DOOR_BOTTOM << DOOR_SECRET_SHIFT;
+    if (tile->secret_left)
+        mask |= DOOR_LEFT << DOOR_SECRET_SHIFT;
+
+    return mask;
+}
+
+int door_mask_count(int mask)
+{
+    int counter = 0;
+    while (mask)
+    {
+        counter += mask & 1;
+        mask = mask >> 1;
+    }
+
+    return counter;
+}
+
+// encodes the current map into the given floor
+void map_floor_save(Floor *floor)
+{
+    if (!floor)
+        return;
+
+    floor->seed = map_seed;
+    floor->level_id = map_level_id;
+    floor->attempts = map_attempts;
+
+    floor->max_rooms = max_rooms;
+    floor->rooms = map_rooms_count;
+    floor->max_secrets = max_secrets;
+    floor->secrets = created_secret_rooms;
+    floor->max_item_rooms = max_item_rooms;
+    floor->item_rooms = created_item_rooms;
+    floor->end_rooms = cell_list_size(&end_rooms_list);
+
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (x = 0; x < MAP_WIDTH; x++)
+        {
+            Tile *tile = &map[x][y];
+            int cell = floor_cell(x, y);
+
+            floor->type[cell] = tile->type;
+            floor->doors[cell] = tile_door_mask(tile);
+            floor->secret_chance[cell] = tile->secret_chance;
+            floor->region[cell] = tile->region;
+            floor->links[cell] = tile->links;
+        }
+    }
+}
+
+// restores the map tiles from the given floor (working lists are left untouched)
+void map_floor_load(Floor *floor)
+{
+    if (!floor)
+        return;
+
+    map_seed = floor->seed;
+    map_level_id = floor->level_id;
+    map_attempts = floor->attempts;
+
+    max_rooms = floor->max_rooms;
+    max_secrets = floor->max_secrets;
+    created_secret_rooms = floor->secrets;
+    max_item_rooms = floor->max_item_rooms;
+    created_item_rooms = floor->item_rooms;
+
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (x = 0; x < MAP_WIDTH; x++)
+        {
+            Tile *tile = &map[x][y];
+            int cell = floor_cell(x, y);
+            reset_tile(tile, x, y);
+
+            int mask = floor->doors[cell];
+            int secret_mask = mask >> DOOR_SECRET_SHIFT;
+
+            tile->type = floor->type[cell];
+            tile->region = floor->region[cell];
+            tile->secret_chance = floor->secret_chance[cell];
+            tile->links = floor->links[cell];
+
+            tile->top = (mask & DOOR_TOP) != 0;
+            tile->right = (mask & DOOR_RIGHT) != 0;
+            tile->bottom = (mask & DOOR_BOTTOM) != 0;
+            tile->left = (mask & DOOR_LEFT) != 0;
+            tile->doors = door_mask_count(mask & 15);
+
+            tile->secret_top = (secret_mask & DOOR_TOP) != 0;
+            tile->secret_right = (secret_mask & DOOR_RIGHT) != 0;
+            tile->secret_bottom = (secret_mask & DOOR_BOTTOM) != 0;
+            tile->secret_left = (secret_mask & DOOR_LEFT) != 0;
+            tile->secret_doors = door_mask_count(secret_mask & 15);
+        }
+    }
+}
+
+// returns first cell of the given room type, or -1 if there is none
+int floor_find_room(Floor *floor, int type)
+{
+    if (!floor)
+        return -1;
+
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+    {
+        if (floor->type[cell] == type)
+            return cell;
+    }
+
+    return -1;
+}
+
+int floor_neighbour_cell(int cell, int dir)
+{
+    int x = (cell % MAP_WIDTH) + cardinal_dx[dir];
+    int y = (cell / MAP_WIDTH) + cardinal_dy[dir];
+    if (!is_in_map(x, y))
+        return -1;
+
+    return floor_cell(x, y);
+}
+
+int floor_bfs_queue[FLOOR_CELLS];
+
+// gives the cell and all other cells of it's room the same depth and queues them, returns the new queue tail
+// cells of a bigger room are connected without doors, so they never add to the depth
+int floor_depths_add_room(Floor *floor, int cell, int room_depth, int *depth, int tail)
+{
+    int head = tail;
+    depth[cell] = room_depth;
+    floor_bfs_queue[tail] = cell;
+    tail++;
+
+    while (head < tail)
+    {
+        cell = floor_bfs_queue[head];
+        head++;
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            if (!(floor->links[cell] & (1 << n)))
+                continue;
+
+            int neighbour = floor_neighbour_cell(cell, n);
+            if (neighbour < 0)
+                continue;
+
+            if (depth[neighbour] >= 0)
+                continue;
+
+            depth[neighbour] = room_depth;
+            floor_bfs_queue[tail] = neighbour;
+            tail++;
+        }
+    }
+
+    return tail;
+}
+
+// breadth first search from the given cell through the (non secret) doors, all cells of a bigger room get the same depth
+// depth receives amount of doors to pass from start for each cell, or -1 if cell can't be reached
+// returns the biggest depth found
+int floor_depths(Floor *floor, int start_cell, int *depth)
+{
+    if (!floor || !depth)
+        return -1;
+
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+        depth[cell] = -1;
+
+    if (start_cell < 0 || start_cell >= FLOOR_CELLS)
+        return -1;
+
+    int head = 0, deepest = 0;
+    int tail = floor_depths_add_room(floor, start_cell, 0, depth, 0);
+
+    // whole rooms are queued at once, so the queue stays sorted by depth
+    while (head < tail)
+    {
+        cell = floor_bfs_queue[head];
+        head++;
+
+        deepest = depth[cell];
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            if (!(floor->doors[cell] & (1 << n)))
+                continue;
+
+            int neighbour = floor_neighbour_cell(cell, n);
+            if (neighbour < 0)
+                continue;
+
+            if (depth[neighbour] >= 0)
+                continue;
+
+            tail = floor_depths_add_room(floor, neighbour, depth[cell] + 1, depth, tail);
+        }
+    }
+
+    return deepest;
+}
+
+int floor_start_cell()
+{
+    int start_x = -1, start_y = -1;
+    get_map_center(&start_x, &start_y);
+    return floor_cell(start_x, start_y);
+}
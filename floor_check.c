@@ -0,0 +1,155 @@
+// invariants of a generated floor, floor_check returns a bit for every one that doesn't hold
+// (world chunks have doors through the map's edge on purpose, so they don't pass the doors check)
+#define FLOOR_CHECK_DOORS 1
+#define FLOOR_CHECK_LINKS 2
+#define FLOOR_CHECK_CONNECTED 4
+#define FLOOR_CHECK_START 8
+#define FLOOR_CHECK_BOSS 16
+#define FLOOR_CHECK_SHOP 32
+#define FLOOR_CHECK_ITEMS 64
+#define FLOOR_CHECK_SECRETS 128
+#define FLOOR_CHECK_SUPER_SECRET 256
+#define FLOOR_CHECKS 9
+
+int floor_check_depth[FLOOR_CELLS];
+int floor_check_counts[ROOM_TYPES];
+
+char *floor_check_name(int index)
+{
+    switch (index)
+    {
+    case 0:
+        return "doors";
+
+    case 1:
+        return "links";
+
+    case 2:
+        return "connected";
+
+    case 3:
+        return "start room";
+
+    case 4:
+        return "boss room";
+
+    case 5:
+        return "shop room";
+
+    case 6:
+        return "item rooms";
+
+    case 7:
+        return "secret rooms";
+
+    case 8:
+        return "super secret room";
+    }
+
+    return "unknown";
+}
+
+// doors of the cell (normal and secret ones) as a 4 bit mask
+int floor_check_open(Floor *floor, int cell)
+{
+    int doors = floor->doors[cell];
+    return (doors | (doors >> DOOR_SECRET_SHIFT)) & 15;
+}
+
+// checks all invariants of the given floor in a single pass over the cells (plus one breadth first search)
+// returns 0 if the floor is fine, otherwise FLOOR_CHECK_* bits of the failed invariants
+int floor_check(Floor *floor)
+{
+    if (!floor)
+        return 0;
+
+    int failed = 0;
+
+    int i = 0;
+    for (i = 0; i < ROOM_TYPES; i++)
+        floor_check_counts[i] = 0;
+
+    floor_depths(floor, floor_start_cell(), floor_check_depth);
+
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+    {
+        int type = floor->type[cell];
+        if (type == ROOM_NONE)
+        {
+            if (floor->doors[cell] || floor->links[cell])
+                failed |= FLOOR_CHECK_DOORS;
+
+            continue;
+        }
+
+        if (type >= ROOM_TYPES)
+            continue;
+
+        floor_check_counts[type]++;
+
+        int open = floor_check_open(floor, cell);
+        int is_secret = type == ROOM_SECRET || type == ROOM_SUPER_SECRET;
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            int back = 1 << ((n + 2) % CARDINAL_DIRECTIONS);
+            int neighbour = floor_neighbour_cell(cell, n);
+            int neighbour_type = ROOM_NONE;
+            if (neighbour >= 0)
+                neighbour_type = floor->type[neighbour];
+
+            // door has to lead into a room that has the door too
+            if (open & (1 << n))
+            {
+                if (neighbour < 0)
+                    failed |= FLOOR_CHECK_DOORS;
+                else if (!(floor_check_open(floor, neighbour) & back))
+                    failed |= FLOOR_CHECK_DOORS;
+            }
+
+            if (floor->links[cell] & (1 << n))
+            {
+                if (neighbour < 0)
+                    failed |= FLOOR_CHECK_LINKS;
+                else if (!(floor->links[neighbour] & back) || floor->region[neighbour] != floor->region[cell] || neighbour_type != type)
+                    failed |= FLOOR_CHECK_LINKS;
+            }
+
+            // super secret room can only touch normal rooms
+            if (type == ROOM_SUPER_SECRET && neighbour_type != ROOM_NONE && neighbour_type != ROOM_NORMAL)
+                failed |= FLOOR_CHECK_SUPER_SECRET;
+        }
+
+        if (is_secret)
+        {
+            if (!open)
+                failed |= FLOOR_CHECK_CONNECTED;
+        }
+        else if (floor_check_depth[cell] < 0)
+        {
+            failed |= FLOOR_CHECK_CONNECTED;
+        }
+    }
+
+    if (floor_check_counts[ROOM_START] != 1)
+        failed |= FLOOR_CHECK_START;
+
+    if (floor_check_counts[ROOM_BOSS] != 1)
+        failed |= FLOOR_CHECK_BOSS;
+
+    if (floor_check_counts[ROOM_SPECIAL] != 1)
+        failed |= FLOOR_CHECK_SHOP;
+
+    if (floor_check_counts[ROOM_LOCKED] != floor->max_item_rooms)
+        failed |= FLOOR_CHECK_ITEMS;
+
+    if (floor_check_counts[ROOM_SECRET] != floor->max_secrets)
+        failed |= FLOOR_CHECK_SECRETS;
+
+    if (floor_check_counts[ROOM_SUPER_SECRET] != 1)
+        failed |= FLOOR_CHECK_SUPER_SECRET;
+
+    return failed;
+}
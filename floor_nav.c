@@ -0,0 +1,228 @@
+// rooms a single navigation table can hold (floors have a few dozen at most, a bigger room counts once)
+#define FLOOR_NAV_MAX_ROOMS 64
+
+// every cell has 4 doors at most (normal or secret)
+#define FLOOR_NAV_MAX_EDGES (FLOOR_CELLS * CARDINAL_DIRECTIONS)
+
+// distance between rooms that can't reach each other
+#define FLOOR_NAV_UNREACHABLE 255
+
+// door graph of a floor over room indices plus all pairs next hop and distance tables
+// so a path query is a single table lookup
+typedef struct FloorNav
+{
+    int rooms;
+
+    // room index -> it's first cell and cell -> room index (-1 for cells without a room)
+    short room_cell[FLOOR_NAV_MAX_ROOMS];
+    short cell_room[FLOOR_CELLS];
+
+    // compressed sparse rows, neighbours of room r are edges[edges_first[r]] ... edges[edges_first[r + 1] - 1]
+    short edges_first[FLOOR_NAV_MAX_ROOMS + 1];
+    unsigned char edges[FLOOR_NAV_MAX_EDGES];
+
+    // cells of room r are cells[cells_first[r]] ... cells[cells_first[r + 1] - 1]
+    short cells_first[FLOOR_NAV_MAX_ROOMS + 1];
+    short cells[FLOOR_CELLS];
+
+    // [from * FLOOR_NAV_MAX_ROOMS + to], next hop is a room index
+    unsigned char next_hop[FLOOR_NAV_MAX_ROOMS * FLOOR_NAV_MAX_ROOMS];
+    unsigned char distance[FLOOR_NAV_MAX_ROOMS * FLOOR_NAV_MAX_ROOMS];
+} FloorNav;
+
+unsigned char floor_nav_queue[FLOOR_NAV_MAX_ROOMS];
+
+int is_floor_nav_secret(int type)
+{
+    return type == ROOM_SECRET || type == ROOM_SUPER_SECRET;
+}
+
+// builds the navigation tables for the given floor, secret doors (and rooms) are only used if use_secrets is true
+// all cells of a bigger room are one room of the tables
+// returns false (and leaves the tables empty) if floor has more than FLOOR_NAV_MAX_ROOMS rooms
+int floor_nav_build(FloorNav *nav, Floor *floor, int use_secrets)
+{
+    if (!nav || !floor)
+        return false;
+
+    nav->rooms = 0;
+
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+        nav->cell_room[cell] = -1;
+
+    // rooms in order of their first cell, cells of a room are found through the links
+    int cells = 0, n = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+    {
+        int type = floor->type[cell];
+        if (type == ROOM_NONE || nav->cell_room[cell] >= 0)
+            continue;
+
+        if (!use_secrets && is_floor_nav_secret(type))
+            continue;
+
+        if (nav->rooms >= FLOOR_NAV_MAX_ROOMS)
+        {
+            for (cell = 0; cell < FLOOR_CELLS; cell++)
+                nav->cell_room[cell] = -1;
+
+            nav->rooms = 0;
+            return false;
+        }
+
+        nav->room_cell[nav->rooms] = cell;
+        nav->cells_first[nav->rooms] = cells;
+        nav->cell_room[cell] = nav->rooms;
+        nav->cells[cells] = cell;
+        cells++;
+
+        int head = nav->cells_first[nav->rooms];
+        while (head < cells)
+        {
+            int current = nav->cells[head];
+            head++;
+
+            for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+            {
+                if (!(floor->links[current] & (1 << n)))
+                    continue;
+
+                int neighbour = floor_neighbour_cell(current, n);
+                if (neighbour < 0 || nav->cell_room[neighbour] >= 0)
+                    continue;
+
+                nav->cell_room[neighbour] = nav->rooms;
+                nav->cells[cells] = neighbour;
+                cells++;
+            }
+        }
+
+        nav->rooms++;
+    }
+    nav->cells_first[nav->rooms] = cells;
+
+    // adjacency, in room order, a room reached through more than one door is added once
+    int room = 0, edges = 0;
+    for (room = 0; room < nav->rooms; room++)
+    {
+        nav->edges_first[room] = edges;
+
+        int i = 0;
+        for (i = nav->cells_first[room]; i < nav->cells_first[room + 1]; i++)
+        {
+            cell = nav->cells[i];
+            int doors = floor->doors[cell];
+            if (use_secrets)
+                doors |= doors >> DOOR_SECRET_SHIFT;
+
+            for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+            {
+                if (!(doors & (1 << n)))
+                    continue;
+
+                int neighbour = floor_neighbour_cell(cell, n);
+                if (neighbour < 0)
+                    continue;
+
+                int other = nav->cell_room[neighbour];
+                if (other < 0 || other == room)
+                    continue;
+
+                int known = false;
+                int j = 0;
+                for (j = nav->edges_first[room]; j < edges; j++)
+                {
+                    if (nav->edges[j] == other)
+                        known = true;
+                }
+
+                if (known)
+                    continue;
+
+                nav->edges[edges] = other;
+                edges++;
+            }
+        }
+    }
+    nav->edges_first[nav->rooms] = edges;
+
+    // breadth first search from every target, parent of a room is it's next hop towards the target
+    int target = 0;
+    for (target = 0; target < nav->rooms; target++)
+    {
+        for (room = 0; room < nav->rooms; room++)
+        {
+            nav->distance[room * FLOOR_NAV_MAX_ROOMS + target] = FLOOR_NAV_UNREACHABLE;
+            nav->next_hop[room * FLOOR_NAV_MAX_ROOMS + target] = room;
+        }
+
+        int head = 0, tail = 0;
+        floor_nav_queue[tail] = target;
+        tail++;
+        nav->distance[target * FLOOR_NAV_MAX_ROOMS + target] = 0;
+
+        while (head < tail)
+        {
+            int current = floor_nav_queue[head];
+            head++;
+
+            int i = 0;
+            for (i = nav->edges_first[current]; i < nav->edges_first[current + 1]; i++)
+            {
+                int next = nav->edges[i];
+                if (nav->distance[next * FLOOR_NAV_MAX_ROOMS + target] != FLOOR_NAV_UNREACHABLE)
+                    continue;
+
+                nav->distance[next * FLOOR_NAV_MAX_ROOMS + target] = nav->distance[current * FLOOR_NAV_MAX_ROOMS + target] + 1;
+                nav->next_hop[next * FLOOR_NAV_MAX_ROOMS + target] = current;
+                floor_nav_queue[tail] = next;
+                tail++;
+            }
+        }
+    }
+
+    return true;
+}
+
+// returns first cell of the room to go to from from_cell on the way to to_cell (to_cell's room if they are neighbours)
+// or -1 if there is no way (or one of the cells has no room)
+int floor_nav_next_cell(FloorNav *nav, int from_cell, int to_cell)
+{
+    if (!nav)
+        return -1;
+
+    if (from_cell < 0 || from_cell >= FLOOR_CELLS || to_cell < 0 || to_cell >= FLOOR_CELLS)
+        return -1;
+
+    int from = nav->cell_room[from_cell];
+    int to = nav->cell_room[to_cell];
+    if (from < 0 || to < 0)
+        return -1;
+
+    if (nav->distance[from * FLOOR_NAV_MAX_ROOMS + to] == FLOOR_NAV_UNREACHABLE)
+        return -1;
+
+    return nav->room_cell[nav->next_hop[from * FLOOR_NAV_MAX_ROOMS + to]];
+}
+
+// returns amount of doors between both cells, or -1 if there is no way
+int floor_nav_distance(FloorNav *nav, int from_cell, int to_cell)
+{
+    if (!nav)
+        return -1;
+
+    if (from_cell < 0 || from_cell >= FLOOR_CELLS || to_cell < 0 || to_cell >= FLOOR_CELLS)
+        return -1;
+
+    int from = nav->cell_room[from_cell];
+    int to = nav->cell_room[to_cell];
+    if (from < 0 || to < 0)
+        return -1;
+
+    int distance = nav->distance[from * FLOOR_NAV_MAX_ROOMS + to];
+    if (distance == FLOOR_NAV_UNREACHABLE)
+        return -1;
+
+    return distance;
+}
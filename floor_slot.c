@@ -0,0 +1,89 @@
+// single producer / single consumer handoff of one finished floor
+// producer only writes while ready is false, consumer only reads while it's true, so neither side has to lock
+typedef struct FloorSlot
+{
+    // published floor, only valid while ready is true
+    Floor *floor;
+
+    // buffer the consumer gave back, producer builds the next floor into it
+    Floor *spare;
+
+    int ready;
+} FloorSlot;
+
+void floor_slot_init(FloorSlot *slot, Floor *spare)
+{
+    if (!slot)
+        return;
+
+    slot->floor = NULL;
+    slot->spare = spare;
+    slot->ready = false;
+}
+
+int is_floor_slot_ready(FloorSlot *slot)
+{
+    if (!slot)
+        return false;
+
+    return slot->ready;
+}
+
+// producer side, returns buffer that the next floor can be written into (or NULL while the slot is still full)
+Floor *floor_slot_spare(FloorSlot *slot)
+{
+    if (!slot)
+        return NULL;
+
+    if (slot->ready)
+        return NULL;
+
+    return slot->spare;
+}
+
+// producer side, floor has to be completely written before it's published
+int floor_slot_publish(FloorSlot *slot, Floor *floor)
+{
+    if (!slot || !floor)
+        return false;
+
+    if (slot->ready)
+        return false;
+
+    slot->spare = NULL;
+    slot->floor = floor;
+    slot->ready = true;
+    return true;
+}
+
+// consumer side, swaps published floor with the current one and hands the old buffer back to the producer
+int floor_slot_swap(FloorSlot *slot, Floor **current)
+{
+    if (!slot || !current)
+        return false;
+
+    if (!slot->ready)
+        return false;
+
+    Floor *old_floor = *current;
+    *current = slot->floor;
+
+    slot->floor = NULL;
+    slot->spare = old_floor;
+    slot->ready = false;
+    return true;
+}
+
+// consumer side, drops published floor (f.e. it was made for another level) and gives it's buffer back
+void floor_slot_discard(FloorSlot *slot)
+{
+    if (!slot)
+        return;
+
+    if (!slot->ready)
+        return;
+
+    slot->spare = slot->floor;
+    slot->floor = NULL;
+    slot->ready = false;
+}
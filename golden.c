@@ -0,0 +1,625 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+
+// golden corpus: fixed seeds per level id, with the hash of every floor and per stage timings
+// floors are generated again and compared with the corpus, files that are missing are recorded instead
+// hashes are the same on every machine, so golden_floors.txt is kept in the repository (delete it after a change that is meant to change floors)
+// timings only make sense on the machine they were taken on, so golden_times.txt is not (delete it after a change that is meant to change speed)
+#define GOLDEN_FILE "golden_floors.txt"
+#define GOLDEN_TIMES_FILE "golden_times.txt"
+#define GOLDEN_REPORT_FILE "golden_report.txt"
+
+#define GOLDEN_FIRST_SEED 1
+#define GOLDEN_SEEDS_PER_LEVEL 64
+#define GOLDEN_LEVELS MAP_LEVELS
+
+// corpus is generated once with single cell rooms and once with room shapes (map_room_shapes)
+#define GOLDEN_CONFIGS 2
+#define GOLDEN_ROOM_SHAPES 3
+
+#define GOLDEN_FLOORS (GOLDEN_CONFIGS * GOLDEN_LEVELS * GOLDEN_SEEDS_PER_LEVEL)
+
+// timing runs, each one generates the whole corpus GOLDEN_REPEATS times
+#define GOLDEN_RUNS 9
+#define GOLDEN_REPEATS 16
+
+// stage is slower if it's median grew by more than the threshold and the mann whitney test says so too
+// (one sided, z of 2.33 is the 1% level)
+#define GOLDEN_THRESHOLD 0.1
+#define GOLDEN_Z 2.33
+
+// timings are stored per stage, plus the total
+#define GOLDEN_TIMES (MAP_STAGES + 1)
+
+// counter run: GOLDEN_REPEATS more passes over the corpus with hardware counters read per stage (see map_counters.c)
+// they are kept out of the timing runs, so reading counters doesn't slow the timed stages down (remove the define to skip it)
+#define GOLDEN_COUNTERS
+
+int golden_recorded = false;
+int golden_times_recorded = false;
+int golden_has_hash[GOLDEN_FLOORS];
+unsigned long golden_hash[GOLDEN_FLOORS * 2];
+double golden_time[GOLDEN_TIMES * GOLDEN_RUNS];
+
+int golden_mismatches = 0;
+int golden_first_mismatch = -1;
+unsigned long golden_new_hash[GOLDEN_FLOORS * 2];
+double golden_new_time[GOLDEN_TIMES * GOLDEN_RUNS];
+
+// runs made step by step (run_step, like generate_run_async does) have to give the same floors as generate_run
+#define GOLDEN_RUN_SEEDS 8
+#define GOLDEN_RUN_BUDGET 50
+
+int golden_run_mismatches = 0;
+
+int golden_regressions = 0;
+double golden_ratio[GOLDEN_TIMES];
+double golden_z[GOLDEN_TIMES];
+
+// counts per floor of every stage (and the total), from the counter run
+double golden_counter[GOLDEN_TIMES * MAP_COUNTERS];
+
+Floor golden_floor;
+
+int golden_index(int config, int level, int seed)
+{
+    return (config * GOLDEN_LEVELS + level) * GOLDEN_SEEDS_PER_LEVEL + seed - GOLDEN_FIRST_SEED;
+}
+
+int golden_config_shapes(int config)
+{
+    if (config == 0)
+        return 0;
+
+    return GOLDEN_ROOM_SHAPES;
+}
+
+// parses next number of the line (decimal, or hex if it starts with 0x), pos is moved behind it
+unsigned long golden_parse_number(char *line, int *pos)
+{
+    int i = *pos;
+    while (line[i] == ' ')
+        i++;
+
+    unsigned long value = 0;
+    if (line[i] == '0' && line[i + 1] == 'x')
+    {
+        i += 2;
+        while (true)
+        {
+            int c = line[i];
+            if (c >= '0' && c <= '9')
+                value = value * 16 + c - '0';
+            else if (c >= 'A' && c <= 'F')
+                value = value * 16 + c - 'A' + 10;
+            else if (c >= 'a' && c <= 'f')
+                value = value * 16 + c - 'a' + 10;
+            else
+                break;
+
+            i++;
+        }
+    }
+    else
+    {
+        while (line[i] >= '0' && line[i] <= '9')
+        {
+            value = value * 10 + line[i] - '0';
+            i++;
+        }
+    }
+
+    *pos = i;
+    return value;
+}
+
+int is_golden_line(char *line, char *word, int length)
+{
+    int i = 0;
+    for (i = 0; i < length; i++)
+    {
+        if (line[i] != word[i])
+            return false;
+    }
+
+    return line[length] == ' ';
+}
+
+void golden_parse_line(char *line)
+{
+    int pos = 0;
+    if (is_golden_line(line, "floor", 5))
+    {
+        pos = 5;
+        int config = golden_parse_number(line, &pos);
+        int level = golden_parse_number(line, &pos);
+        int seed = golden_parse_number(line, &pos);
+        if (config >= GOLDEN_CONFIGS || level >= GOLDEN_LEVELS || seed < GOLDEN_FIRST_SEED || seed >= GOLDEN_FIRST_SEED + GOLDEN_SEEDS_PER_LEVEL)
+            return;
+
+        int index = golden_index(config, level, seed);
+        golden_hash[index * 2] = golden_parse_number(line, &pos);
+        golden_hash[index * 2 + 1] = golden_parse_number(line, &pos);
+        golden_has_hash[index] = true;
+        return;
+    }
+
+    if (is_golden_line(line, "time", 4))
+    {
+        pos = 4;
+        int stage = golden_parse_number(line, &pos);
+        if (stage >= GOLDEN_TIMES)
+            return;
+
+        int run = 0;
+        for (run = 0; run < GOLDEN_RUNS; run++)
+            golden_time[stage * GOLDEN_RUNS + run] = golden_parse_number(line, &pos);
+    }
+}
+
+// returns false if the file isn't there yet
+int golden_load(char *file_name)
+{
+    var file = file_open_read(file_name);
+    if (!file)
+        return false;
+
+    char line[256];
+
+    int length = 0, done = false;
+    while (!done)
+    {
+        int c = file_asc_read(file);
+        if (c < 0)
+            done = true;
+
+        if (c == '\r')
+            continue;
+
+        if (c != '\n' && !done)
+        {
+            if (length < 255)
+            {
+                line[length] = c;
+                length++;
+            }
+
+            continue;
+        }
+
+        line[length] = 0;
+        length = 0;
+
+        if (line[0] == 0)
+            continue;
+
+        if (line[0] == '/' && line[1] == '/')
+            continue;
+
+        golden_parse_line(line);
+    }
+
+    file_close(file);
+    return true;
+}
+
+void golden_save_floors()
+{
+    var file = file_open_write(GOLDEN_FILE);
+    if (!file)
+        return;
+
+    file_str_write(file, "// golden floors: config (0 = single cell rooms, 1 = room shapes), level, seed, first two floor hash words\n\n");
+
+    int config = 0, level = 0, seed = 0;
+    for (config = 0; config < GOLDEN_CONFIGS; config++)
+    {
+        for (level = 0; level < GOLDEN_LEVELS; level++)
+        {
+            for (seed = GOLDEN_FIRST_SEED; seed < GOLDEN_FIRST_SEED + GOLDEN_SEEDS_PER_LEVEL; seed++)
+            {
+                int index = golden_index(config, level, seed);
+                file_str_write(file, str_printf(NULL, "floor %d %d %d 0x%08X 0x%08X\n", (long)config, (long)level, (long)seed,
+                                                 (long)golden_new_hash[index * 2], (long)golden_new_hash[index * 2 + 1]));
+            }
+        }
+    }
+
+    file_close(file);
+}
+
+void golden_save_times()
+{
+    var file = file_open_write(GOLDEN_TIMES_FILE);
+    if (!file)
+        return;
+
+    file_str_write(file, "// golden timings: stage (last one is the total), microseconds of every run\n\n");
+
+    int stage = 0;
+    for (stage = 0; stage < GOLDEN_TIMES; stage++)
+    {
+        file_str_write(file, str_printf(NULL, "time %d", (long)stage));
+
+        int run = 0;
+        for (run = 0; run < GOLDEN_RUNS; run++)
+            file_str_write(file, str_printf(NULL, " %d", (long)golden_new_time[stage * GOLDEN_RUNS + run]));
+
+        file_str_write(file, "\n");
+    }
+
+    file_close(file);
+}
+
+// generates the whole corpus, compares hashes with the recorded ones if check is true
+void golden_generate(int check)
+{
+    int old_level_id = level_id;
+    int old_room_shapes = map_room_shapes;
+
+    FloorHash hash;
+
+    int config = 0, level = 0, seed = 0;
+    for (config = 0; config < GOLDEN_CONFIGS; config++)
+    {
+        map_room_shapes = golden_config_shapes(config);
+
+        for (level = 0; level < GOLDEN_LEVELS; level++)
+        {
+            for (seed = GOLDEN_FIRST_SEED; seed < GOLDEN_FIRST_SEED + GOLDEN_SEEDS_PER_LEVEL; seed++)
+            {
+                map_generate_level(seed, level);
+                if (!check)
+                    continue;
+
+                map_floor_save(&golden_floor);
+                floor_hash(&golden_floor, &hash, false);
+
+                int index = golden_index(config, level, seed);
+                golden_new_hash[index * 2] = hash.h[0];
+                golden_new_hash[index * 2 + 1] = hash.h[1];
+
+                if (!golden_recorded || !golden_has_hash[index])
+                    continue;
+
+                if (golden_hash[index * 2] == hash.h[0] && golden_hash[index * 2 + 1] == hash.h[1])
+                    continue;
+
+                golden_mismatches++;
+                if (golden_first_mismatch < 0)
+                    golden_first_mismatch = index;
+            }
+        }
+    }
+
+    level_id = old_level_id;
+    map_room_shapes = old_room_shapes;
+}
+
+int is_golden_floor_same(Floor *floor, Floor *other)
+{
+    if (!floor || !other)
+        return false;
+
+    FloorHash hash, other_hash;
+    floor_hash(floor, &hash, false);
+    floor_hash(other, &other_hash, false);
+    return floor_hash_compare(&hash, &other_hash) == 0;
+}
+
+void golden_check_runs()
+{
+    int i = 0;
+    for (i = 0; i < GOLDEN_RUN_SEEDS; i++)
+    {
+        int seed = GOLDEN_FIRST_SEED + i;
+
+        Run *run = generate_run(seed);
+        Run *stepped = run_create(seed);
+        if (run && stepped)
+        {
+            while (!run_step(stepped, GOLDEN_RUN_BUDGET))
+                continue;
+
+            int level = 0;
+            for (level = 0; level < run->levels; level++)
+            {
+                if (!is_golden_floor_same(run_floor(run, level), run_floor(stepped, level)))
+                    golden_run_mismatches++;
+            }
+        }
+
+        run_destroy(run);
+        run_destroy(stepped);
+    }
+}
+
+int is_golden_failed()
+{
+    return golden_mismatches > 0 || golden_run_mismatches > 0 || golden_regressions > 0;
+}
+
+// one timing run, stage times are summed over GOLDEN_REPEATS passes over the corpus
+void golden_time_run(int run)
+{
+    map_reset_stage_times();
+    map_stage_timing = true;
+
+    int i = 0;
+    for (i = 0; i < GOLDEN_REPEATS; i++)
+        golden_generate(false);
+
+    map_stage_timing = false;
+
+    double total = 0;
+
+    int stage = 0;
+    for (stage = 0; stage < MAP_STAGES; stage++)
+    {
+        golden_new_time[stage * GOLDEN_RUNS + run] = map_stage_time[stage];
+        total += map_stage_time[stage];
+    }
+
+    golden_new_time[MAP_STAGES * GOLDEN_RUNS + run] = total;
+}
+
+// one more pass over the corpus with counters on, keeps their counts per floor
+void golden_counter_run()
+{
+    map_reset_stage_times();
+    map_reset_stage_counters();
+    map_stage_timing = true;
+    map_stage_counting = true;
+
+    int i = 0;
+    for (i = 0; i < GOLDEN_REPEATS; i++)
+        golden_generate(false);
+
+    map_stage_counting = false;
+    map_stage_timing = false;
+
+    double floors = GOLDEN_REPEATS * GOLDEN_FLOORS;
+
+    int counter = 0;
+    for (counter = 0; counter < MAP_COUNTERS; counter++)
+    {
+        double total = 0;
+
+        int stage = 0;
+        for (stage = 0; stage < MAP_STAGES; stage++)
+        {
+            golden_counter[stage * MAP_COUNTERS + counter] = map_stage_counter[stage * MAP_COUNTERS + counter] / floors;
+            total += map_stage_counter[stage * MAP_COUNTERS + counter];
+        }
+
+        golden_counter[MAP_STAGES * MAP_COUNTERS + counter] = total / floors;
+    }
+}
+
+double golden_median(double *values)
+{
+    double sorted[GOLDEN_RUNS];
+    memcpy(sorted, values, sizeof(double) * GOLDEN_RUNS);
+
+    int i = 0;
+    for (i = 1; i < GOLDEN_RUNS; i++)
+    {
+        double value = sorted[i];
+
+        int j = i - 1;
+        while (j >= 0)
+        {
+            if (sorted[j] <= value)
+                break;
+
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+
+        sorted[j + 1] = value;
+    }
+
+    return sorted[GOLDEN_RUNS / 2];
+}
+
+// mann whitney u test of the new runs against the recorded ones, returns z (big z means new runs are slower)
+double golden_mann_whitney(double *old_times, double *new_times)
+{
+    double u = 0;
+
+    int i = 0, j = 0;
+    for (i = 0; i < GOLDEN_RUNS; i++)
+    {
+        for (j = 0; j < GOLDEN_RUNS; j++)
+        {
+            if (new_times[i] > old_times[j])
+                u += 1;
+            else if (new_times[i] == old_times[j])
+                u += 0.5;
+        }
+    }
+
+    double mean = GOLDEN_RUNS * GOLDEN_RUNS / 2.0;
+    double deviation = sqrt(GOLDEN_RUNS * GOLDEN_RUNS * (GOLDEN_RUNS * 2 + 1) / 12.0);
+    return (u - mean) / deviation;
+}
+
+void golden_compare_times()
+{
+    int stage = 0;
+    for (stage = 0; stage < GOLDEN_TIMES; stage++)
+    {
+        double *old_times = &golden_time[stage * GOLDEN_RUNS];
+        double *new_times = &golden_new_time[stage * GOLDEN_RUNS];
+
+        double old_median = golden_median(old_times);
+        if (old_median < 1)
+            old_median = 1;
+
+        golden_ratio[stage] = golden_median(new_times) / old_median;
+        golden_z[stage] = golden_mann_whitney(old_times, new_times);
+
+        if (golden_ratio[stage] > 1 + GOLDEN_THRESHOLD && golden_z[stage] > GOLDEN_Z)
+            golden_regressions++;
+    }
+}
+
+char *golden_time_name(int stage)
+{
+    if (stage == MAP_STAGES)
+        return "total";
+
+    return map_stage_name(stage);
+}
+
+void golden_write_counters_header(var file)
+{
+    if (!map_counters_any)
+    {
+        file_str_write(file, " counters");
+        return;
+    }
+
+    int counter = 0;
+    for (counter = 0; counter < MAP_COUNTERS; counter++)
+        file_str_write(file, str_printf(NULL, " %14s", map_counter_name(counter)));
+}
+
+// counts per floor next to the stage's timings, counters that can't be read on this machine say so
+void golden_write_counters(var file, int stage)
+{
+    if (!map_counters_any)
+    {
+        file_str_write(file, " counters unavailable");
+        return;
+    }
+
+    int counter = 0;
+    for (counter = 0; counter < MAP_COUNTERS; counter++)
+    {
+        if (map_counter_available[counter])
+            file_str_write(file, str_printf(NULL, " %14.0f", (double)golden_counter[stage * MAP_COUNTERS + counter]));
+        else
+            file_str_write(file, str_printf(NULL, " %14s", "n/a"));
+    }
+}
+
+void golden_write_report()
+{
+    var file = file_open_write(GOLDEN_REPORT_FILE);
+    if (!file)
+        return;
+
+    if (is_golden_failed())
+        file_str_write(file, "result=FAIL;\n");
+    else
+        file_str_write(file, "result=PASS;\n");
+
+    if (!golden_recorded)
+        file_str_write(file, str_printf(NULL, "floors recorded to %s;\n", GOLDEN_FILE));
+
+    if (!golden_times_recorded)
+        file_str_write(file, str_printf(NULL, "timings recorded to %s;\n", GOLDEN_TIMES_FILE));
+
+    file_str_write(file, str_printf(NULL, "floors=%d;\nmismatches=%d;\n", (long)GOLDEN_FLOORS, (long)golden_mismatches));
+
+    if (golden_first_mismatch >= 0)
+    {
+        int index = golden_first_mismatch;
+        file_str_write(file, str_printf(NULL, "first mismatch: config=%d; level=%d; seed=%d;\n", (long)(index / (GOLDEN_LEVELS * GOLDEN_SEEDS_PER_LEVEL)),
+                                         (long)((index / GOLDEN_SEEDS_PER_LEVEL) % GOLDEN_LEVELS), (long)(GOLDEN_FIRST_SEED + index % GOLDEN_SEEDS_PER_LEVEL)));
+    }
+
+    file_str_write(file, str_printf(NULL, "runs=%d;\nrun mismatches=%d;\n", (long)GOLDEN_RUN_SEEDS, (long)golden_run_mismatches));
+
+    file_str_write(file, str_printf(NULL, "\nslower stages=%d;\n%-24s %12s %12s %8s %8s", (long)golden_regressions, "stage", "recorded us", "now us", "ratio", "z"));
+#ifdef GOLDEN_COUNTERS
+    golden_write_counters_header(file);
+#endif
+    file_str_write(file, "\n");
+
+    int stage = 0;
+    for (stage = 0; stage < GOLDEN_TIMES; stage++)
+    {
+        file_str_write(file, str_printf(NULL, "%-24s %12.0f %12.0f %8.3f %8.2f", golden_time_name(stage), (double)golden_median(&golden_time[stage * GOLDEN_RUNS]),
+                                         (double)golden_median(&golden_new_time[stage * GOLDEN_RUNS]), (double)golden_ratio[stage], (double)golden_z[stage]));
+#ifdef GOLDEN_COUNTERS
+        golden_write_counters(file, stage);
+#endif
+        file_str_write(file, "\n");
+    }
+
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+
+    golden_recorded = golden_load(GOLDEN_FILE);
+    golden_times_recorded = golden_load(GOLDEN_TIMES_FILE);
+
+    draw_text("generating golden floors...", 10, 10, COLOR_RED);
+    wait(1);
+
+    golden_generate(true);
+    golden_check_runs();
+
+    // timing runs are time sliced over frames, so the window stays responsive
+    int run = 0;
+    for (run = 0; run < GOLDEN_RUNS; run++)
+    {
+        golden_time_run(run);
+
+        draw_text(str_printf(NULL, "timing run=%d/%d;", (long)(run + 1), (long)GOLDEN_RUNS), 10, 10, COLOR_RED);
+        wait(1);
+
+        if (key_esc)
+            return;
+    }
+
+#ifdef GOLDEN_COUNTERS
+    draw_text("counter run...", 10, 10, COLOR_RED);
+    wait(1);
+
+    golden_counter_run();
+#endif
+
+    if (!golden_recorded)
+        golden_save_floors();
+
+    // first run on this machine, timings are compared with themselves
+    if (!golden_times_recorded)
+    {
+        golden_save_times();
+        memcpy(golden_time, golden_new_time, sizeof(double) * GOLDEN_TIMES * GOLDEN_RUNS);
+    }
+
+    golden_compare_times();
+    golden_write_report();
+
+    while (!key_esc)
+    {
+        if (!golden_recorded)
+            draw_text(str_printf(NULL, "corpus recorded to %s", GOLDEN_FILE), 10, 10, COLOR_RED);
+        else if (is_golden_failed())
+            draw_text(str_printf(NULL, "FAIL: mismatches=%d; slower stages=%d; see %s", (long)golden_mismatches, (long)golden_regressions, GOLDEN_REPORT_FILE), 10, 10, COLOR_RED);
+        else
+            draw_text(str_printf(NULL, "PASS, see %s", GOLDEN_REPORT_FILE), 10, 10, COLOR_RED);
+
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
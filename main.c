@@ -4,859 +4,431 @@
 #define PRAGMA_POINTER
 
 #include "vector2d.c"
-#include "dynamic_array.h"
-
-#define MIN(x, y) ifelse(x <= y, x, y)
-#define MAX(x, y) ifelse(x >= y, x, y)
-#define RANDOM_CHANCE(c) integer(random(c)) == 0
-#define RANDOM_RANGE(min, max) (min + integer(random(max - min)))
-
-#define MAP_WIDTH 15
-#define MAP_HEIGHT 15
-#define MAP_CELL_SIZE 32
-
-#define ROOM_NONE 0
-#define ROOM_NORMAL 1
-#define ROOM_START 2
-#define ROOM_BOSS 3
-#define ROOM_SPECIAL 4
-#define ROOM_LOCKED 5
-#define ROOM_SECRET 6
-#define ROOM_SUPER_SECRET 7
+
+#include "map.c"
+#include "map_pool.c"
+#include "floor_slot.c"
+#include "room_templates.c"
+#include "world.c"
+#include "room_sprites.c"
+#include "profile_overlay.c"
 
 #define DEBUG_FONT_SCALE 0.5
 
-#define MAX_ROOM_SPRITES 16
-#define ROOM_TOP 0
-#define ROOM_RIGHT 1
-#define ROOM_BOTTOM 2
-#define ROOM_LEFT 3
-#define ROOM_TOP_N_RIGHT 4
-#define ROOM_RIGHT_N_BOTTOM 5
-#define ROOM_BOTTOM_N_LEFT 6
-#define ROOM_LEFT_N_TOP 7
-#define ROOM_LEFT_TOP_N_RIGHT 8
-#define ROOM_TOP_RIGHT_N_BOTTOM 9
-#define ROOM_RIGHT_BOTTOM_N_LEFT 10
-#define ROOM_BOTTOM_LEFT_N_TOP 11
-#define ROOM_TOP_N_BOTTOM 12
-#define ROOM_RIGHT_N_LEFT 13
-#define ROOM_ALL_SIDES 14
-#define ROOM_VOID 15
-
-#define CARDINAL_DIRECTIONS 4
-#define CARDINAL_TOP 0
-#define CARDINAL_RIGHT 1
-#define CARDINAL_BOTTOM 2
-#define CARDINAL_LEFT 3
-
-// up, right, bottom, left
-// up-right, right-bottom, bottom-left, left-up
-// left-up-right, up-right-bottom, right-bottom-left, bottom-left-up
-// up-bottom, left-right, all-sides, none
-BMAP *rooms_pcx = "rooms.pcx";
-BMAP *room[MAX_ROOM_SPRITES];
-
-typedef struct Tile
-{
-    int region;
-    int x;
-    int y;
-
-    int type;
-
-    int doors;
-    int top;
-    int right;
-    int bottom;
-    int left;
-
-    int secret_chance;
-    int secret_doors;
-    int secret_top;
-    int secret_right;
-    int secret_bottom;
-    int secret_left;
-} Tile;
-
-int level_id = 2;
-int max_level_id = 5;
-int max_rooms = 0;
-int max_secrets = 0;
-int max_item_rooms = 0;
-int created_item_rooms = 0;
-int created_secret_rooms = 0;
-int boss_room_found = false;
-int shop_room_found = false;
-int super_secret_created = false;
-
-Array *rooms_queue_list;
-Array *end_rooms_list;
-Array *secret_positions_list;
-Array *secret_rooms_list;
-Array *super_positions_list;
-
-Tile map[MAP_WIDTH][MAP_HEIGHT];
-
-Vector2d cardinal_dir[CARDINAL_DIRECTIONS];
-
-int is_in_map(int x, int y)
-{
-    return x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT;
-}
+#define MAP_UNIQUE_RETRIES 8
 
-void snap_to_grid(Vector2d *pos)
-{
-    if (!pos)
-        return;
+// floors seen this session, so players don't run into repeated layouts
+FloorHashSet *seen_floors_set;
 
-    pos->x += (MAP_CELL_SIZE / 2) * sign(pos->x);
-    pos->x = (integer(pos->x / MAP_CELL_SIZE) * MAP_CELL_SIZE);
-    pos->y += (MAP_CELL_SIZE / 2) * sign(pos->y);
-    pos->y = (integer(pos->y / MAP_CELL_SIZE) * MAP_CELL_SIZE);
-}
+// floor that is drawn and the one being prefetched, the map globals are only used as generator's scratch
+Floor floor_buffers[2];
+Floor *current_floor = &floor_buffers[0];
 
-void get_map_center(int *x, int *y)
-{
-    *x = integer(MAP_WIDTH / 2);
-    *y = integer(MAP_HEIGHT / 2);
-}
+FloorSlot next_floor_slot;
+int map_prefetch_running = false;
 
-void reset_tile(Tile *tile, int x, int y)
-{
-    if (!tile)
-        return;
+// time the prefetch task may take out of every frame (in microseconds), floors that aren't in the pool are generated step by step
+#define MAP_PREFETCH_BUDGET 2000
 
-    tile->region = -1;
-    tile->x = x;
-    tile->y = y;
+// 1 in this many new rooms tries to get a bigger shape while shapes are on (toggled with s)
+#define MAP_DEMO_ROOM_SHAPES 3
 
-    tile->type = ROOM_NONE;
+MapJob map_prefetch_job;
+int map_prefetch_job_running = false;
+int map_prefetch_tries = 0;
 
-    tile->doors = 0;
-    tile->top = false;
-    tile->right = false;
-    tile->bottom = false;
-    tile->left = false;
+// interiors of the current floor's rooms, made when the player enters them
+RoomInteriors room_interiors;
+FloorNav floor_nav;
+int floor_nav_ready = false;
+int player_cell = -1;
 
-    tile->secret_chance = 0;
-    tile->secret_doors = 0;
-    tile->secret_top = false;
-    tile->secret_right = false;
-    tile->secret_bottom = false;
-    tile->secret_left = false;
-}
+#define ROOM_INTERIOR_CELL_SIZE 8
 
-void map_reset()
-{
-    int x = 0, y = 0;
-    for (y = 0; y < MAP_HEIGHT; y++)
-        for (x = 0; x < MAP_WIDTH; x++)
-            reset_tile(&map[x][y], x, y);
-}
+// endless world, shown instead of the floor while world mode is on
+#define WORLD_BUDGET_BYTES (512 * 1024)
+#define WORLD_CELL_SIZE 8
 
-void room_create(Tile *tile, int type)
-{
-    if (!tile)
-        return;
+World *world;
+WorldPosition world_player;
+int world_mode = false;
 
-    array_add(rooms_queue_list, tile);
+// generator fuzzing in the background (toggled with f)
+#define MAP_FUZZ_PER_FRAME 256
 
-    tile->type = type;
-    tile->region = array_size(rooms_queue_list);
-}
+MapFuzz map_fuzz;
+int map_fuzz_running = false;
 
-int count_bordering_rooms(Tile *tile)
+// true if the player was on this floor (or one that looks the same) this session already
+int is_floor_seen(Floor *floor)
 {
-    if (!tile)
+    if (!seen_floors_set)
         return false;
 
-    int x = tile->x;
-    int y = tile->y;
-
-    int n = 0, counter = 4;
-    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
-    {
-        int nx = x + cardinal_dir[n].x;
-        int ny = y + cardinal_dir[n].y;
-        if (!is_in_map(nx, ny))
-            continue;
-
-        if (map[nx][ny].type != ROOM_NONE)
-            continue;
-
-        counter--;
-    }
-
-    return counter;
+    FloorHash hash;
+    floor_hash(floor, &hash, true);
+    return floor_hash_set_contains(seen_floors_set, &hash);
 }
 
-int is_valid_neighbour(Tile *neighbour)
+// floor is the one the player is on now, it counts as seen from now on
+// (floors are only marked once they are shown, so a prefetched floor that gets discarded can still come up later)
+void floor_mark_seen(Floor *floor)
 {
-    if (!neighbour)
-        return false;
-
-    if (neighbour->type != ROOM_NONE)
-        return false;
-
-    if (count_bordering_rooms(neighbour) > 1)
-        return false;
+    if (!seen_floors_set)
+        seen_floors_set = floor_hash_set_create(64);
 
-    if (array_size(rooms_queue_list) >= max_rooms)
-        return false;
-
-    if (RANDOM_CHANCE(2))
-        return false;
-
-    return true;
+    FloorHash hash;
+    floor_hash(floor, &hash, true);
+    floor_hash_set_insert(seen_floors_set, &hash);
 }
 
-void map_add_rooms()
+// fills floor with a new floor for the current level (taken from the pool, or generated right away)
+void map_produce_floor(Floor *floor)
 {
-    // add starting room to the queue
-    int start_x = -1, start_y = -1;
-    get_map_center(&start_x, &start_y);
-    if (!is_in_map(start_x, start_y))
+    if (!floor)
         return;
 
-    room_create(&map[start_x][start_y], ROOM_START);
-
-    // cycle though the queue
-    array_enumerate_begin(Tile *, rooms_queue_list, v)
+    int i = 0;
+    for (i = 0; i < MAP_UNIQUE_RETRIES; i++)
     {
-        if (!v)
-            continue;
-
-        int x = v->x;
-        int y = v->y;
-
-        int n = 0;
-        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        if (!map_pool_take(level_id, floor))
         {
-            int nx = x + cardinal_dir[n].x;
-            int ny = y + cardinal_dir[n].y;
-            if (!is_in_map(nx, ny))
-                continue;
-
-            Tile *neighbour = &map[nx][ny];
-            if (!neighbour)
-                continue;
-
-            if (!is_valid_neighbour(neighbour))
-                continue;
-
-            v->doors++;
-            neighbour->doors++;
-
-            switch (n)
-            {
-            case CARDINAL_TOP:
-                v->top = true;
-                neighbour->bottom = true;
-                break;
-
-            case CARDINAL_RIGHT:
-                v->right = true;
-                neighbour->left = true;
-                break;
-
-            case CARDINAL_BOTTOM:
-                v->bottom = true;
-                neighbour->top = true;
-                break;
-
-            case CARDINAL_LEFT:
-                v->left = true;
-                neighbour->right = true;
-                break;
-            }
-
-            room_create(neighbour, ROOM_NORMAL);
+            map_generate_seeded(map_random_floor_seed());
+            map_floor_save(floor);
         }
-    }
-    array_enumerate_end(rooms_queue_list);
-}
-
-void map_add_tile_to_array(Tile *tile, Array *array)
-{
-    if (!tile || !array)
-        return;
 
-    array_add(array, tile);
+        if (!is_floor_seen(floor))
+            break;
+    }
 }
 
-void map_find_end_rooms()
+// works on the next floor for MAP_PREFETCH_BUDGET microseconds at most, returns true once floor holds it
+// same as map_produce_floor, only floors that aren't in the pool are generated over as many frames as it takes
+int map_prefetch_step(Floor *floor)
 {
-    array_enumerate_begin(Tile *, rooms_queue_list, v)
+    // level changed meanwhile, floor of the old one is no use anymore
+    if (map_prefetch_job_running && map_prefetch_job.level_id != level_id)
     {
-        if (!v)
-            continue;
-
-        if (v->type != ROOM_NORMAL)
-            continue;
-
-        if (v->doors > 1)
-            continue;
-
-        if (count_bordering_rooms(v) > 1)
-            continue;
-
-        map_add_tile_to_array(v, end_rooms_list);
+        map_prefetch_job_running = false;
+        map_prefetch_tries = 0;
     }
-    array_enumerate_end(rooms_queue_list);
-}
-
-var get_distance(int x1, int y1, int x2, int y2)
-{
-    VECTOR start, end;
-    vec_set(&start, vector(x1 * MAP_CELL_SIZE, y1 * MAP_CELL_SIZE, 0));
-    vec_set(&end, vector(x2 * MAP_CELL_SIZE, y2 * MAP_CELL_SIZE, 0));
-    return vec_dist(&start, &end);
-}
-
-void map_find_boss_room()
-{
-    int x = -1, y = -1;
-    var farthest_distance = 0;
-
-    int start_x = -1, start_y = -1;
-    get_map_center(&start_x, &start_y);
-    if (!is_in_map(start_x, start_y))
-        return;
 
-    array_enumerate_begin(Tile *, end_rooms_list, v)
+    if (!map_prefetch_job_running && !map_pool_take(level_id, floor))
     {
-        if (!v)
-            continue;
+        map_generate_begin(&map_prefetch_job, map_random_floor_seed(), level_id, floor);
+        map_prefetch_job_running = true;
+    }
 
-        var dist = get_distance(v->x, v->y, start_x, start_y);
+    if (map_prefetch_job_running)
+    {
+        if (!map_generate_step(&map_prefetch_job, MAP_PREFETCH_BUDGET))
+            return false;
 
-        if (dist >= farthest_distance)
-        {
-            x = v->x;
-            y = v->y;
-            farthest_distance = dist;
-        }
+        map_prefetch_job_running = false;
     }
-    array_enumerate_end(end_rooms_list);
 
-    if (x != -1 && y != -1)
-        boss_room_found = true;
+    // floor that was seen already is made again next frame (until retries run out)
+    map_prefetch_tries++;
+    if (is_floor_seen(floor) && map_prefetch_tries < MAP_UNIQUE_RETRIES)
+        return false;
 
-    if (boss_room_found == true)
-        map[x][y].type = ROOM_BOSS;
+    map_prefetch_tries = 0;
+    return true;
 }
 
-void map_find_shop_room()
+// background task, keeps the next floor ready while the current one is played
+void map_prefetch()
 {
-    int start_x = -1, start_y = -1;
-    get_map_center(&start_x, &start_y);
-    if (!is_in_map(start_x, start_y))
+    if (map_prefetch_running)
         return;
 
-    int x = -1, y = -1;
-    Tile *temp_tile = array_first(Tile *, end_rooms_list);
-    if (!temp_tile)
-        return;
+    map_prefetch_running = true;
+    map_prefetch_job_running = false;
+    map_prefetch_tries = 0;
+    floor_slot_init(&next_floor_slot, &floor_buffers[1]);
 
-    var closest_distance = get_distance(temp_tile->x, temp_tile->y, start_x, start_y);
-
-    array_enumerate_begin(Tile *, end_rooms_list, v)
+    while (map_prefetch_running)
     {
-        if (!v)
-            continue;
+        Floor *next_floor = floor_slot_spare(&next_floor_slot);
+        if (next_floor && map_prefetch_step(next_floor))
+            floor_slot_publish(&next_floor_slot, next_floor);
 
-        if (v->type != ROOM_NORMAL)
-            continue;
-
-        var dist = get_distance(v->x, v->y, start_x, start_y);
-        if (dist <= closest_distance)
-        {
-            x = v->x;
-            y = v->y;
-            closest_distance = dist;
-        }
+        wait(1);
     }
-    array_enumerate_end(end_rooms_list);
-
-    if (x != -1 && y != -1)
-        shop_room_found = true;
-
-    if (shop_room_found == true)
-        map[x][y].type = ROOM_SPECIAL;
 }
 
-void map_find_item_rooms()
+// moves player into the given room and instantiates it's interior (if it wasn't entered before)
+void player_enter_room(int cell)
 {
-    array_enumerate_begin(Tile *, end_rooms_list, v)
-    {
-        if (!v)
-            continue;
-
-        if (v->type != ROOM_NORMAL)
-            continue;
-
-        v->type = ROOM_LOCKED;
+    if (cell < 0 || cell >= FLOOR_CELLS)
+        return;
 
-        created_item_rooms++;
-        if (created_item_rooms >= max_item_rooms)
-            break;
-    }
-    array_enumerate_end(end_rooms_list);
+    player_cell = cell;
+    room_interior_get(&room_interiors, current_floor, player_cell);
 }
 
-int map_secret_position_contains(Tile *tile)
+void player_enter_floor()
 {
-    if (!tile)
-        return false;
-
-    int found = false;
-    array_enumerate_begin(Tile *, secret_positions_list, v)
-    {
-        if (!v)
-            continue;
-
-        if (found)
-            break;
-
-        if (v->x == tile->x && v->y == tile->y)
-            found = true;
-    }
-    array_enumerate_end(secret_positions_list);
-    return found;
+    room_interiors_reset(&room_interiors, current_floor);
+    // floors with too many rooms for the tables just don't show the way to the boss
+    floor_nav_ready = floor_nav_build(&floor_nav, current_floor, false);
+    player_enter_room(floor_start_cell());
 }
 
-int map_normal_neighbour_counter(int x, int y, int type)
+// moves player through the door in the given cardinal direction (if there is one)
+void player_move(int n)
 {
-    if (!is_in_map(x, y))
-        return false;
-
-    int n = 0, counter = 0;
-    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    if (world_mode)
     {
-        int nx = x + cardinal_dir[n].x;
-        int ny = y + cardinal_dir[n].y;
-        if (!is_in_map(nx, ny))
-            continue;
-
-        Tile *neighbour = &map[nx][ny];
-        if (!neighbour)
-            continue;
+        world_move(world, &world_player, n);
+        return;
+    }
 
-        if (neighbour->type != type)
-            continue;
+    if (player_cell < 0)
+        return;
 
-        counter++;
-    }
+    int doors = current_floor->doors[player_cell];
+    doors |= (doors >> DOOR_SECRET_SHIFT) | current_floor->links[player_cell];
+    if (!(doors & (1 << n)))
+        return;
 
-    return counter;
+    player_enter_room(floor_neighbour_cell(player_cell, n));
 }
 
-int map_valid_secret_position(Tile *tile)
+void player_move_up()
 {
-    if (!tile)
-        return false;
-
-    if (tile->type != ROOM_NONE)
-        return false;
-
-    if (tile->secret_chance <= 0)
-        return false;
-
-    if (map_secret_position_contains(tile))
-        return false;
-
-    if (map_normal_neighbour_counter(tile->x, tile->y, ROOM_NORMAL) <= 0)
-        return false;
-
-    if (map_normal_neighbour_counter(tile->x, tile->y, ROOM_BOSS) > 0)
-        return false;
-
-    return true;
+    player_move(CARDINAL_TOP);
 }
 
-void map_find_secret_positions()
+void player_move_right()
 {
-    array_enumerate_begin(Tile *, rooms_queue_list, v)
-    {
-        if (!v)
-            continue;
-
-        if (v->type == ROOM_START || v->type == ROOM_BOSS)
-            continue;
-
-        int x = v->x;
-        int y = v->y;
+    player_move(CARDINAL_RIGHT);
+}
 
-        int n = 0;
-        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
-        {
-            int nx = x + cardinal_dir[n].x;
-            int ny = y + cardinal_dir[n].y;
-            if (!is_in_map(nx, ny))
-                continue;
+void player_move_down()
+{
+    player_move(CARDINAL_BOTTOM);
+}
 
-            Tile *neighbour = &map[nx][ny];
-            if (!neighbour)
-                continue;
+void player_move_left()
+{
+    player_move(CARDINAL_LEFT);
+}
 
-            if (neighbour->type != ROOM_NONE)
-                continue;
+void map_generate()
+{
+    level_load("");
 
-            neighbour->secret_chance++;
+    if (is_floor_slot_ready(&next_floor_slot) && next_floor_slot.floor->level_id != level_id)
+        floor_slot_discard(&next_floor_slot);
 
-            if (!map_valid_secret_position(neighbour))
-                continue;
+    // switching to the prefetched floor is just a pointer swap
+    if (!floor_slot_swap(&next_floor_slot, &current_floor))
+        map_produce_floor(current_floor);
 
-            array_add(secret_positions_list, neighbour);
-        }
-    }
-    array_enumerate_end(rooms_queue_list);
+    floor_mark_seen(current_floor);
+    player_enter_floor();
+    beep();
 }
 
-int is_secret_already_added(Tile *tile)
+// grows the current floor again from it's seed and rolls new special and secret rooms for it
+void map_reroll_current()
 {
-    if (!tile)
-        return false;
-
-    int found = false;
-    array_enumerate_begin(Tile *, secret_rooms_list, v)
-    {
-        if (!v)
-            continue;
-
-        if (found)
-            break;
-
-        if (v->x == tile->x && v->y == tile->y)
-            found = true;
-    }
-    array_enumerate_end(secret_rooms_list);
+    map_generate_level(current_floor->seed, current_floor->level_id);
+    if (!map_reroll_specials(map_random_floor_seed()))
+        return;
 
-    return found;
+    map_floor_save(current_floor);
+    player_enter_floor();
 }
 
-int is_valid_secret_neighbour(Tile *tile)
+// turns room shapes on or off, floors made with the old setting are thrown away and a new one is shown
+void map_room_shapes_toggle()
 {
-    if (!tile)
-        return false;
+    if (map_room_shapes > 0)
+        map_room_shapes = 0;
+    else
+        map_room_shapes = MAP_DEMO_ROOM_SHAPES;
 
-    if (tile->type == ROOM_NONE || tile->type == ROOM_BOSS || tile->type == ROOM_SECRET || tile->type == ROOM_SUPER_SECRET)
-        return false;
+    map_pools_clear();
+    floor_slot_discard(&next_floor_slot);
+    map_prefetch_job_running = false;
+    map_prefetch_tries = 0;
 
-    return true;
+    map_generate();
 }
 
-void map_add_secret_rooms()
+// checks MAP_FUZZ_PER_FRAME new floors every frame until it's toggled off again
+void map_fuzz_toggle()
 {
-    var lifespan = 1;
-    while (lifespan > 0)
+    if (map_fuzz_running)
     {
-        lifespan -= time_frame / 16;
-
-        int highest_chance = 0, x = -1, y = -1;
-        array_enumerate_begin(Tile *, secret_positions_list, v)
-        {
-            if (!v)
-                continue;
-
-            if (v->type != ROOM_NONE)
-                continue;
-
-            if (v->secret_chance < highest_chance)
-                continue;
-
-            if (is_secret_already_added(v))
-                continue;
-
-            x = v->x;
-            y = v->y;
-            highest_chance = v->secret_chance;
-        }
-        array_enumerate_end(secret_positions_list);
+        map_fuzz_running = false;
+        return;
+    }
 
-        if (x != -1 && y != -1)
-            array_add(secret_rooms_list, &map[x][y]);
+    map_fuzz_running = true;
+    map_fuzz_reset(&map_fuzz, map_random_floor_seed());
 
-        if (array_size(secret_rooms_list) >= max_secrets)
-            break;
+    while (map_fuzz_running)
+    {
+        map_fuzz_run(&map_fuzz, MAP_FUZZ_PER_FRAME);
+        wait(1);
     }
+}
 
-    array_enumerate_begin(Tile *, secret_rooms_list, v)
+// switches between the floor and the endless world (made from a new seed the first time)
+void world_toggle()
+{
+    if (!world)
     {
-        if (!v)
-            continue;
+        world = world_create(map_random_floor_seed(), level_id, WORLD_BUDGET_BYTES);
+        if (!world)
+            return;
 
-        v->type = ROOM_SECRET;
-        v->region = 0;
-
-        int x = v->x;
-        int y = v->y;
-
-        int n = 0;
-        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
-        {
-            int nx = x + cardinal_dir[n].x;
-            int ny = y + cardinal_dir[n].y;
-            if (!is_in_map(nx, ny))
-                continue;
-
-            Tile *neighbour = &map[nx][ny];
-            if (!neighbour)
-                continue;
-
-            if (!is_valid_secret_neighbour(neighbour))
-                continue;
-
-            v->doors++;
-            neighbour->secret_doors++;
-
-            switch (n)
-            {
-            case CARDINAL_TOP:
-                neighbour->secret_bottom = true;
-                v->top = true;
-                break;
-
-            case CARDINAL_RIGHT:
-                neighbour->secret_left = true;
-                v->right = true;
-                break;
-
-            case CARDINAL_BOTTOM:
-                neighbour->secret_top = true;
-                v->bottom = true;
-                break;
-
-            case CARDINAL_LEFT:
-                neighbour->secret_right = true;
-                v->left = true;
-                break;
-            }
-        }
-
-        created_secret_rooms++;
-        if (created_secret_rooms >= max_secrets)
-            break;
+        world_player.chunk_x = 0;
+        world_player.chunk_y = 0;
+        world_player.cell = floor_start_cell();
     }
-    array_enumerate_end(secret_rooms_list);
-}
 
-int is_valid_super_secret_neighbour(Tile *tile)
-{
-    if (!tile)
-        return false;
+    world_mode = !world_mode;
 }
 
-void map_add_super_secret_positions()
+VECTOR *room_type_color(int type)
 {
-    array_enumerate_begin(Tile *, secret_positions_list, v)
+    switch (type)
     {
-        if (!v)
-            continue;
+    case ROOM_NORMAL:
+        return vector(128, 128, 128);
 
-        if (v->secret_chance != 1)
-            continue;
+    case ROOM_START:
+        return vector(0, 128, 0);
 
-        if (count_bordering_rooms(v) > 1)
-            continue;
+    case ROOM_BOSS:
+        return vector(0, 0, 128);
 
-        int x = v->x;
-        int y = v->y;
+    case ROOM_SPECIAL:
+        return vector(128, 128, 0);
 
-        int n = 0, counter = 0;
-        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
-        {
-            int nx = x + cardinal_dir[n].x;
-            int ny = y + cardinal_dir[n].y;
-            if (!is_in_map(nx, ny))
-                continue;
-
-            Tile *neighbour = &map[nx][ny];
-            if (!neighbour)
-                continue;
-
-            if (neighbour->type == ROOM_NONE)
-                continue;
+    case ROOM_LOCKED:
+        return vector(128, 0, 0);
 
-            if (neighbour->type != ROOM_NORMAL)
-                continue;
-
-            counter++;
-        }
-
-        if (counter <= 0)
-            continue;
+    case ROOM_SECRET:
+        return vector(64, 64, 64);
 
-        array_add(super_positions_list, v);
+    case ROOM_SUPER_SECRET:
+        return vector(32, 64, 128);
     }
-    array_enumerate_end(secret_positions_list);
+
+    return vector(8, 8, 8);
 }
 
-void map_add_super_secret_room()
+// draws the chunks around the player, chunks that aren't generated yet are left out
+void world_draw(int pos_x, int pos_y)
 {
-    int index = RANDOM_RANGE(0, array_size(super_positions_list));
-    Tile *super_secret_room = array_get_at(Tile *, super_positions_list, index);
-    if (!super_secret_room)
+    if (!world)
         return;
 
-    super_secret_room->type = ROOM_SUPER_SECRET;
-    super_secret_room->region = 0;
-
-    int x = super_secret_room->x;
-    int y = super_secret_room->y;
+    int chunk_size = MAP_WIDTH * WORLD_CELL_SIZE;
 
-    int n = 0, counter = 0;
-    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    int i = 0, j = 0;
+    for (j = -WORLD_PREFETCH_RADIUS; j <= WORLD_PREFETCH_RADIUS; j++)
     {
-        int nx = x + cardinal_dir[n].x;
-        int ny = y + cardinal_dir[n].y;
-        if (!is_in_map(nx, ny))
-            continue;
-
-        Tile *neighbour = &map[nx][ny];
-        if (!neighbour)
-            continue;
-
-        if (neighbour->type != ROOM_NORMAL)
-            continue;
+        for (i = -WORLD_PREFETCH_RADIUS; i <= WORLD_PREFETCH_RADIUS; i++)
+        {
+            WorldChunk *chunk = world_find_chunk(world, world_player.chunk_x + i, world_player.chunk_y + j);
+            if (!chunk)
+                continue;
 
-        super_secret_room->doors++;
-        neighbour->secret_doors++;
+            int chunk_x = pos_x + (i + WORLD_PREFETCH_RADIUS) * chunk_size;
+            int chunk_y = pos_y + (j + WORLD_PREFETCH_RADIUS) * chunk_size;
 
-        switch (n)
-        {
-        case CARDINAL_TOP:
-            neighbour->secret_bottom = true;
-            super_secret_room->top = true;
-            break;
+            int cell = 0;
+            for (cell = 0; cell < FLOOR_CELLS; cell++)
+            {
+                int type = chunk->floor.type[cell];
+                if (type == ROOM_NONE)
+                    continue;
 
-        case CARDINAL_RIGHT:
-            neighbour->secret_left = true;
-            super_secret_room->right = true;
-            break;
+                int x = chunk_x + (cell % MAP_WIDTH) * WORLD_CELL_SIZE;
+                int y = chunk_y + (cell / MAP_WIDTH) * WORLD_CELL_SIZE;
+                draw_quad(NULL, vector(x + 1, y + 1, 0), NULL, vector(WORLD_CELL_SIZE - 2, WORLD_CELL_SIZE - 2, 0), NULL, room_type_color(type), 100, 0);
 
-        case CARDINAL_BOTTOM:
-            neighbour->secret_top = true;
-            super_secret_room->bottom = true;
-            break;
+                if (chunk->floor.doors[cell] & DOOR_RIGHT)
+                    draw_quad(NULL, vector(x + WORLD_CELL_SIZE - 1, y + 3, 0), NULL, vector(2, 2, 0), NULL, COLOR_WHITE, 100, 0);
 
-        case CARDINAL_LEFT:
-            neighbour->secret_right = true;
-            super_secret_room->left = true;
-            break;
+                if (chunk->floor.doors[cell] & DOOR_BOTTOM)
+                    draw_quad(NULL, vector(x + 3, y + WORLD_CELL_SIZE - 1, 0), NULL, vector(2, 2, 0), NULL, COLOR_WHITE, 100, 0);
+            }
         }
     }
+
+    int player_x = pos_x + (WORLD_PREFETCH_RADIUS * MAP_WIDTH + world_player.cell % MAP_WIDTH) * WORLD_CELL_SIZE;
+    int player_y = pos_y + (WORLD_PREFETCH_RADIUS * MAP_HEIGHT + world_player.cell / MAP_WIDTH) * WORLD_CELL_SIZE;
+    draw_quad(NULL, vector(player_x + 2, player_y + 2, 0), NULL, vector(4, 4, 0), NULL, COLOR_GREEN, 100, 0);
 }
 
-void map_generate()
+void room_interior_draw(RoomInterior *interior, int pos_x, int pos_y)
 {
-    if ((MAP_WIDTH % 2) == false || (MAP_HEIGHT % 2) == false)
+    if (!interior)
         return;
 
-    max_rooms = RANDOM_RANGE(0, 2) + 5 + minv(level_id, max_level_id) * 2.6;
+    VECTOR size;
+    vec_set(&size, vector(ROOM_INTERIOR_CELL_SIZE, ROOM_INTERIOR_CELL_SIZE, 0));
 
-    if (level_id == 0)
-    {
-        max_secrets = 1;
-        max_item_rooms = 1;
-    }
-    else
+    int x = 0, y = 0;
+    for (y = 0; y < ROOM_INTERIOR_HEIGHT; y++)
     {
-        max_secrets = RANDOM_RANGE(0, 2) + 1;
-        max_item_rooms = RANDOM_RANGE(0, 2) + 1;
-    }
-
-    created_item_rooms = 0;
-    created_secret_rooms = 0;
-
-    boss_room_found = false;
-    shop_room_found = false;
-    super_secret_created = false;
-
-    map_reset();
-
-    array_destroy(rooms_queue_list);
-    array_destroy(end_rooms_list);
-    array_destroy(secret_positions_list);
-    array_destroy(secret_rooms_list);
-    array_destroy(super_positions_list);
-
-    rooms_queue_list = array_create(Tile *);
-    end_rooms_list = array_create(Tile *);
-    secret_positions_list = array_create(Tile *);
-    secret_rooms_list = array_create(Tile *);
-    super_positions_list = array_create(Tile *);
+        for (x = 0; x < ROOM_INTERIOR_WIDTH; x++)
+        {
+            VECTOR color;
+            vec_set(&color, vector(48, 48, 48));
 
-    level_load("");
+            switch (interior->cells[room_interior_cell(x, y)])
+            {
+            case ROOM_CELL_ROCK:
+                vec_set(&color, vector(96, 96, 96));
+                break;
 
-    map_add_rooms();
-    wait_for(map_add_rooms);
-    if (array_size(rooms_queue_list) != max_rooms)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_PIT:
+                vec_set(&color, vector(8, 8, 8));
+                break;
 
-    map_find_end_rooms();
-    wait_for(map_find_end_rooms);
-    if (array_size(end_rooms_list) < 2 + max_item_rooms)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_SPIKES:
+                vec_set(&color, vector(128, 128, 255));
+                break;
 
-    map_find_boss_room();
-    wait_for(map_find_boss_room);
-    if (!boss_room_found)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_ENEMY:
+                vec_set(&color, vector(0, 0, 200));
+                break;
 
-    map_find_shop_room();
-    wait_for(map_find_shop_room);
-    if (!shop_room_found)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_PICKUP:
+                vec_set(&color, vector(0, 200, 200));
+                break;
 
-    map_find_item_rooms();
-    wait_for(map_find_item_rooms);
+            case ROOM_CELL_BOSS:
+                vec_set(&color, vector(128, 0, 128));
+                break;
 
-    map_find_secret_positions();
-    wait_for(map_find_secret_positions);
-    if (array_size(secret_positions_list) < max_secrets)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_ITEM:
+                vec_set(&color, vector(200, 200, 0));
+                break;
 
-    map_add_secret_rooms();
-    wait_for(map_add_secret_rooms);
-    if (created_secret_rooms != max_secrets)
-    {
-        map_generate();
-        return;
-    }
+            case ROOM_CELL_SHOP_ITEM:
+                vec_set(&color, vector(0, 200, 0));
+                break;
+            }
 
-    map_add_super_secret_positions();
-    wait_for(map_add_super_secret_positions);
-    if (array_size(super_positions_list) <= 0)
-    {
-        map_generate();
-        return;
+            draw_quad(NULL, vector(pos_x + x * ROOM_INTERIOR_CELL_SIZE, pos_y + y * ROOM_INTERIOR_CELL_SIZE, 0), NULL, &size, NULL, &color, 100, 0);
+        }
     }
-
-    map_add_super_secret_room();
-    wait_for(map_add_super_secret_room);
-
-    beep();
 }
 
-void map_draw(int pos_x, int pos_y)
+void map_draw(Floor *floor, int pos_x, int pos_y)
 {
+    if (!floor)
+        return;
+
     int x = 0, y = 0;
     for (y = 0; y < MAP_HEIGHT; y++)
     {
@@ -868,12 +440,11 @@ void map_draw(int pos_x, int pos_y)
             VECTOR size;
             vec_set(&size, vector(MAP_CELL_SIZE * DEBUG_FONT_SCALE, MAP_CELL_SIZE * DEBUG_FONT_SCALE, 0));
 
-            int type = map[x][y].type;
+            int cell = floor_cell(x, y);
+            int type = floor->type[cell];
 
-            int top_room = map[x][y].top;
-            int right_room = map[x][y].right;
-            int bottom_room = map[x][y].bottom;
-            int left_room = map[x][y].left;
+            // walls between cells of a bigger room are left open
+            int openings = floor->doors[cell] | floor->links[cell];
 
             VECTOR color;
             vec_set(&color, COLOR_WHITE);
@@ -884,38 +455,7 @@ void map_draw(int pos_x, int pos_y)
             if (type == ROOM_SECRET || type == ROOM_SUPER_SECRET)
                 vec_set(&color, COLOR_GREY);
 
-            if (top_room && !right_room && !bottom_room && !left_room)
-                draw_quad(room[ROOM_TOP], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && right_room && !bottom_room && !left_room)
-                draw_quad(room[ROOM_RIGHT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && !right_room && bottom_room && !left_room)
-                draw_quad(room[ROOM_BOTTOM], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && !right_room && !bottom_room && left_room)
-                draw_quad(room[ROOM_LEFT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && right_room && !bottom_room && !left_room)
-                draw_quad(room[ROOM_TOP_N_RIGHT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && right_room && bottom_room && !left_room)
-                draw_quad(room[ROOM_RIGHT_N_BOTTOM], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && !right_room && bottom_room && left_room)
-                draw_quad(room[ROOM_BOTTOM_N_LEFT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && !right_room && !bottom_room && left_room)
-                draw_quad(room[ROOM_LEFT_N_TOP], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && right_room && !bottom_room && left_room)
-                draw_quad(room[ROOM_LEFT_TOP_N_RIGHT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && right_room && bottom_room && !left_room)
-                draw_quad(room[ROOM_TOP_RIGHT_N_BOTTOM], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && right_room && bottom_room && left_room)
-                draw_quad(room[ROOM_RIGHT_BOTTOM_N_LEFT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && !right_room && bottom_room && left_room)
-                draw_quad(room[ROOM_BOTTOM_LEFT_N_TOP], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && !right_room && bottom_room && !left_room)
-                draw_quad(room[ROOM_TOP_N_BOTTOM], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && right_room && !bottom_room && left_room)
-                draw_quad(room[ROOM_RIGHT_N_LEFT], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (top_room && right_room && bottom_room && left_room)
-                draw_quad(room[ROOM_ALL_SIDES], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
-            else if (!top_room && !right_room && !bottom_room && !left_room)
-                draw_quad(room[ROOM_VOID], &pos, NULL, NULL, vector(bmap_scale, bmap_scale, 0), &color, bmap_alpha, 0);
+            room_sprite_draw(openings, &pos, bmap_scale, &color, bmap_alpha);
 
             if (key_enter)
             {
@@ -957,10 +497,10 @@ void map_draw(int pos_x, int pos_y)
                     break;
                 }
 
-                if (map[x][y].type == ROOM_NONE)
-                    draw_text(str_for_num(NULL, map[x][y].secret_chance), temp_x, temp_y, COLOR_WHITE);
+                if (type == ROOM_NONE)
+                    draw_text(str_for_num(NULL, floor->secret_chance[cell]), temp_x, temp_y, COLOR_WHITE);
                 else
-                    draw_text(str_for_num(NULL, map[x][y].region), temp_x, temp_y, COLOR_WHITE);
+                    draw_text(str_for_num(NULL, floor->region[cell]), temp_x, temp_y, COLOR_WHITE);
             }
         }
     }
@@ -1010,48 +550,31 @@ void map_draw(int pos_x, int pos_y)
     }
 }
 
-void room_bmaps_create()
-{
-    int width = 16;
-    int height = 16;
-
-    int i = 0, x = 0, y = 0;
-    for (i = 0; i < MAX_ROOM_SPRITES; i++)
-    {
-        room[i] = bmap_createblack(MAP_CELL_SIZE, MAP_CELL_SIZE, 8888);
-        bmap_blitpart(room[i], rooms_pcx, NULL, NULL, vector(x * height, y * width, 0), vector(height, width, 0));
-
-        x++;
-        if (x >= 4)
-        {
-            x = 0;
-            y++;
-        }
-    }
-}
-
-void room_bmaps_destroy()
-{
-    int i = 0;
-    for (i = 0; i < MAX_ROOM_SPRITES; i++)
-        safe_remove(room[i]);
-}
-
 void on_exit_event()
 {
-    array_destroy(rooms_queue_list);
-    array_destroy(end_rooms_list);
-    array_destroy(secret_positions_list);
-    array_destroy(secret_rooms_list);
-    array_destroy(super_positions_list);
+    map_prefetch_running = false;
+    map_fuzz_running = false;
+
+    floor_hash_set_destroy(seen_floors_set);
+    world_destroy(world);
+    map_pools_destroy();
 
-    room_bmaps_destroy();
+    room_sprites_destroy();
 }
 
 void main()
 {
     on_exit = on_exit_event;
     on_space = map_generate;
+    on_r = map_reroll_current;
+    on_cuu = player_move_up;
+    on_cur = player_move_right;
+    on_cud = player_move_down;
+    on_cul = player_move_left;
+    on_w = world_toggle;
+    on_f = map_fuzz_toggle;
+    on_p = profile_overlay_toggle;
+    on_s = map_room_shapes_toggle;
 
     random_seed(0);
 
@@ -1063,24 +586,82 @@ void main()
 
     draw_textmode("Arial", 0, MAP_CELL_SIZE * DEBUG_FONT_SCALE, 100);
 
-    room_bmaps_create();
+    room_sprites_create();
+    room_templates_load("room_templates.txt");
 
-    vec2d_set(&cardinal_dir[CARDINAL_TOP], 0, -1);
-    vec2d_set(&cardinal_dir[CARDINAL_RIGHT], 1, 0);
-    vec2d_set(&cardinal_dir[CARDINAL_BOTTOM], 0, 1);
-    vec2d_set(&cardinal_dir[CARDINAL_LEFT], -1, 0);
+    map_init();
+    map_pools_create();
 
     map_generate();
+    map_pool_refill();
+    map_prefetch();
 
     while (!key_esc)
     {
         draw_text(str_printf(NULL,
                              "level=%d;\nrooms=%d/%d;\nsecrets=%d/%d;\nlocked=%d/%d;\ntotal endrooms=%d;",
-                             (long)level_id, (long)array_size(rooms_queue_list), (long)max_rooms, (long)created_secret_rooms,
-                             (long)max_secrets, (long)created_item_rooms, (long)max_item_rooms, (long)array_size(end_rooms_list)),
+                             (long)current_floor->level_id, (long)current_floor->rooms, (long)current_floor->max_rooms, (long)current_floor->secrets,
+                             (long)current_floor->max_secrets, (long)current_floor->item_rooms, (long)current_floor->max_item_rooms, (long)current_floor->end_rooms),
                   10, 10, COLOR_RED);
 
-        map_draw(384, 128);
+        draw_text(str_printf(NULL, "pool=%d/%d;\nrefills/sec=%d;", (long)map_pool_occupancy(level_id), (long)MAP_POOL_CAPACITY, (long)map_pool_refill_rate),
+                  384, 10, COLOR_RED);
+
+        if (map_fuzz.checked > 0)
+        {
+            draw_text(str_printf(NULL, "fuzz checked=%d;\nfuzz failed=%d;\nfirst failed seed=%d (level %d);", (long)map_fuzz.checked, (long)map_fuzz.failed,
+                                 (long)map_fuzz.failed_seed, (long)map_fuzz.failed_level),
+                      640, 10, COLOR_RED);
+        }
+
+        if (world_mode)
+        {
+            world_prefetch(world, world_player.chunk_x, world_player.chunk_y);
+            world_draw(384, 128);
+
+            draw_text(str_printf(NULL, "chunk=%d,%d;\ncached=%d;\ngenerated=%d;\nevicted=%d;", (long)world_player.chunk_x, (long)world_player.chunk_y,
+                                 (long)(world->generated - world->evicted), (long)world->generated, (long)world->evicted),
+                      10, 240, COLOR_RED);
+
+            wait(1);
+            continue;
+        }
+
+        double draw_start = map_clock_update();
+        map_draw(current_floor, 384, 128);
+        profile_overlay_add_draw_time(map_clock_update() - draw_start);
+        profile_overlay_draw(10, 400);
+
+        if (player_cell >= 0)
+        {
+            int player_x = player_cell % MAP_WIDTH;
+            int player_y = player_cell / MAP_WIDTH;
+            draw_quad(NULL, vector(384 + player_x * MAP_CELL_SIZE + 12, 128 + player_y * MAP_CELL_SIZE + 12, 0), NULL, vector(8, 8, 0), NULL, COLOR_GREEN, 100, 0);
+
+            room_interior_draw(room_interior_get(&room_interiors, current_floor, player_cell), 10, 320);
+
+            // next room on the way to the boss
+            if (floor_nav_ready)
+            {
+                int boss_cell = floor_find_room(current_floor, ROOM_BOSS);
+                int boss_distance = floor_nav_distance(&floor_nav, player_cell, boss_cell);
+
+                int next_cell = floor_nav_next_cell(&floor_nav, player_cell, boss_cell);
+                if (next_cell >= 0 && boss_distance > 0)
+                {
+                    int next_x = next_cell % MAP_WIDTH;
+                    int next_y = next_cell / MAP_WIDTH;
+                    draw_quad(NULL, vector(384 + next_x * MAP_CELL_SIZE + 14, 128 + next_y * MAP_CELL_SIZE + 14, 0), NULL, vector(4, 4, 0), NULL, COLOR_GREEN, 100, 0);
+                }
+
+                draw_text(str_printf(NULL, "boss in %d rooms;", (long)boss_distance), 10, 240, COLOR_RED);
+            }
+            else
+            {
+                draw_text("boss way unknown;", 10, 240, COLOR_RED);
+            }
+        }
+
         wait(1);
     }
 }
\ No newline at end of file
@@ -0,0 +1,1909 @@
+#define MIN(x, y) ifelse(x <= y, x, y)
+#define MAX(x, y) ifelse(x >= y, x, y)
+#define RANDOM_CHANCE(c) map_random(c) == 0
+#define RANDOM_RANGE(min, max) (min + map_random(max - min))
+
+// map size is a compile time constant, so every loop and neighbour offset below is specialized for it
+// define MAP_SIZE_9 or MAP_SIZE_13 before including map.c for 9x9 or 13x13 maps (15x15 otherwise)
+#ifdef MAP_SIZE_9
+#define MAP_WIDTH 9
+#define MAP_HEIGHT 9
+#else
+#ifdef MAP_SIZE_13
+#define MAP_WIDTH 13
+#define MAP_HEIGHT 13
+#else
+#define MAP_WIDTH 15
+#define MAP_HEIGHT 15
+#endif
+#endif
+
+#define MAP_CELL_SIZE 32
+
+// occupancy grid with a one cell wall ring around the map, so neighbour probes need no bounds checks
+// cells are stored as (x + 1) + (y + 1) * MAP_STRIDE
+#define MAP_STRIDE (MAP_WIDTH + 2)
+#define MAP_GRID_CELLS (MAP_STRIDE * (MAP_HEIGHT + 2))
+#define MAP_GRID_EMPTY 0
+#define MAP_GRID_ROOM 1
+
+// wall ring is never a valid cell for a room, it weighs the same as a room (map's edge counts as a bordering room)
+#define MAP_GRID_WALL 1
+
+#define ROOM_NONE 0
+#define ROOM_NORMAL 1
+#define ROOM_START 2
+#define ROOM_BOSS 3
+#define ROOM_SPECIAL 4
+#define ROOM_LOCKED 5
+#define ROOM_SECRET 6
+#define ROOM_SUPER_SECRET 7
+#define ROOM_TYPES 8
+
+#define CARDINAL_DIRECTIONS 4
+#define CARDINAL_TOP 0
+#define CARDINAL_RIGHT 1
+#define CARDINAL_BOTTOM 2
+#define CARDINAL_LEFT 3
+
+// generation stages, in the order map_generate_attempt runs them
+#define MAP_STAGE_ROOMS 0
+#define MAP_STAGE_END_ROOMS 1
+#define MAP_STAGE_BOSS_ROOM 2
+#define MAP_STAGE_SHOP_ROOM 3
+#define MAP_STAGE_ITEM_ROOMS 4
+#define MAP_STAGE_SECRET_POSITIONS 5
+#define MAP_STAGE_SECRET_ROOMS 6
+#define MAP_STAGE_SUPER_POSITIONS 7
+#define MAP_STAGE_SUPER_ROOM 8
+#define MAP_STAGES 9
+
+// no stage is being timed
+#define MAP_STAGE_NONE -1
+
+// generation checkpoints, named after the stages that are rolled again from them
+#define MAP_CHECKPOINT_SPECIALS 0
+#define MAP_CHECKPOINT_SECRETS 1
+#define MAP_CHECKPOINTS 2
+
+// lists kept in a checkpoint
+#define MAP_LISTS 5
+
+// how many times secret rooms are placed again when they leave no space for the super secret room
+#define MAP_SECRET_RETRIES 3
+
+// how many sub seeds map_reroll_* tries before giving up
+#define MAP_REROLL_TRIES 8
+
+// room shapes, every shape fits into 2x2 cells (shape 0 is the usual single cell room)
+#define MAP_SHAPE_SINGLE 0
+#define MAP_SHAPES 8
+#define MAP_SHAPE_CELLS 4
+
+#include "bitboard.c"
+#include "cell_list.c"
+#include "map_counters.c"
+
+typedef struct Tile
+{
+    int region;
+    int x;
+    int y;
+
+    int type;
+
+    int doors;
+    int top;
+    int right;
+    int bottom;
+    int left;
+
+    int secret_chance;
+    int secret_doors;
+    int secret_top;
+    int secret_right;
+    int secret_bottom;
+    int secret_left;
+
+    // bit per cardinal direction, set towards cells of the same room (no wall, and no door either)
+    int links;
+} Tile;
+
+// level ids 0 ... MAP_LEVELS - 1, tools that keep something per level size their arrays with it
+#define MAP_LEVELS 6
+
+int level_id = 2;
+int max_level_id = MAP_LEVELS - 1;
+int map_seed = 0;
+int map_level_id = 0;
+int map_attempts = 0;
+int max_rooms = 0;
+int max_secrets = 0;
+int max_item_rooms = 0;
+int created_item_rooms = 0;
+int created_secret_rooms = 0;
+int boss_room_found = false;
+int shop_room_found = false;
+int super_secret_created = false;
+
+// end rooms the layout has while it's growing
+int map_end_rooms_count = 0;
+
+// rooms created so far, a room bigger than one cell still counts as one room
+int map_rooms_count = 0;
+
+// 1 in map_room_shapes new rooms tries to get a bigger shape, 0 keeps all rooms single cells
+int map_room_shapes = 0;
+
+// generation parameters, defaults give the floors the game always had (map_tuner.c looks for other ones)
+// max_rooms is RANDOM_RANGE(0, map_rooms_spread) + map_rooms_base + level * map_rooms_per_level / 10
+int map_rooms_base = 5;
+int map_rooms_spread = 2;
+int map_rooms_per_level = 26;
+
+// 1 in map_grow_skip free neighbours doesn't become a room while the layout grows (2 or more)
+int map_grow_skip = 2;
+
+// after the first level there are min ... min + spread - 1 secrets and item rooms
+int map_secrets_min = 1;
+int map_secrets_spread = 2;
+int map_item_rooms_min = 1;
+int map_item_rooms_spread = 2;
+
+// true adds a room whenever the queue runs out before max_rooms (see map_revive_growth)
+// that changes the layouts (deeper floors), so it's off unless map_tuner.c turns it on
+int map_revive = false;
+
+// occupancy of every shape, 2 rows of 2 bits (bit 0 is the left column)
+int map_shape_rows[16] = {
+    1, 0,  // 1x1
+    1, 1,  // 1x2
+    3, 0,  // 2x1
+    3, 3,  // 2x2
+    3, 1,  // L shapes, 2x2 with one corner missing
+    3, 2,
+    1, 3,
+    2, 3};
+
+// filled by map_shapes_init from map_shape_rows
+// halo is made of the cells around the shape, 4 rows of 4 bits starting one cell up and left of the shape
+int map_shape_width[MAP_SHAPES];
+int map_shape_height[MAP_SHAPES];
+int map_shape_halo[MAP_SHAPES * 4];
+int map_shape_cell_count[MAP_SHAPES];
+int map_shape_cells[MAP_SHAPES * MAP_SHAPE_CELLS];
+int map_shape_links[MAP_SHAPES * MAP_SHAPE_CELLS];
+
+// ties in room picks are broken randomly instead of by list order (used for variants)
+int map_random_picks = false;
+
+// working lists, as cells of the map
+CellList rooms_queue_list;
+CellList end_rooms_list;
+CellList secret_positions_list;
+CellList secret_rooms_list;
+CellList super_positions_list;
+
+Tile map[MAP_WIDTH][MAP_HEIGHT];
+
+int map_cell(Tile *tile)
+{
+    return tile->x + tile->y * MAP_WIDTH;
+}
+
+// returns NULL for -1 (or any other cell outside of the map)
+Tile *map_cell_tile(int cell)
+{
+    if (cell < 0 || cell >= MAP_WIDTH * MAP_HEIGHT)
+        return NULL;
+
+    return &map[cell % MAP_WIDTH][cell / MAP_WIDTH];
+}
+
+void map_list_add(CellList *list, Tile *tile)
+{
+    if (!list || !tile)
+        return;
+
+    cell_list_add(list, map_cell(tile));
+}
+
+Tile *map_list_get_at(CellList *list, int index)
+{
+    return map_cell_tile(cell_list_get_at(list, index));
+}
+
+// size is read again on every step, so the list can grow while it's enumerated (rooms queue does)
+#define map_list_enumerate_begin(list, v) do{ int i; for (i = 0; i < (list)->size; i++) { Tile *v = map_list_get_at(list, i);
+#define map_list_enumerate_end(list) }}while (0)
+
+// occupied cells (rooms of any type), kept in sync with the tiles
+Bitboard map_rooms_board;
+Bitboard map_end_rooms_board;
+Bitboard map_secret_positions_board;
+
+// cells secret rooms aren't allowed to take
+Bitboard map_secret_blocked_board;
+
+// secret chance of every cell, as bit planes
+Bitboard map_secret_chance_planes[BITBOARD_COUNT_PLANES];
+
+// cardinal direction offsets, in map cells and in grid cells
+int cardinal_dx[CARDINAL_DIRECTIONS] = {0, 1, 0, -1};
+int cardinal_dy[CARDINAL_DIRECTIONS] = {-1, 0, 1, 0};
+int cardinal_grid_offset[CARDINAL_DIRECTIONS] = {-MAP_STRIDE, 1, MAP_STRIDE, -1};
+
+// occupancy of the map with the wall ring, kept in sync with map_rooms_board
+unsigned char map_grid[MAP_GRID_CELLS];
+
+// empty map with the wall ring, copied into map_grid on reset
+unsigned char map_grid_blank[MAP_GRID_CELLS];
+
+// how many attempts were rejected by each stage (never reset by the generator itself)
+int map_stage_rejections[MAP_STAGES];
+
+// microseconds spent in each stage, only measured while map_stage_timing is on (never reset by the generator itself)
+int map_stage_timing = false;
+int map_timed_stage = MAP_STAGE_NONE;
+double map_timed_stage_start = 0;
+double map_stage_time[MAP_STAGES];
+
+// stage times of the floor being generated, they go to map_last_floor_* once it's done (only while map_stage_timing is on)
+double map_floor_stage_time[MAP_STAGES];
+double map_last_floor_stage_time[MAP_STAGES];
+double map_last_floor_time = 0;
+int map_last_floor_attempts = 0;
+
+// total times of the last MAP_TIMED_FLOORS timed floors (ring buffer, map_timed_floors is the amount of timed floors so far)
+#define MAP_TIMED_FLOORS 256
+double map_timed_floor_time[MAP_TIMED_FLOORS];
+int map_timed_floors = 0;
+
+// microseconds since the first map_clock_update call
+// dtimer only gives the time since it's last call, so all generator timing goes through here
+double map_clock = 0;
+
+// snapshot of the generator state, so later stages can be run again without growing the layout
+// only map columns that rooms (or their neighbours) reach are stored, nothing else is touched after growing
+typedef struct MapCheckpoint
+{
+    int valid;
+
+    // bit per stored map column
+    int columns;
+    Tile tiles[MAP_WIDTH][MAP_HEIGHT];
+
+    Bitboard rooms_board;
+    unsigned char grid[MAP_GRID_CELLS];
+    Bitboard end_rooms_board;
+    Bitboard secret_positions_board;
+    Bitboard secret_chance_planes[BITBOARD_COUNT_PLANES];
+
+    int end_rooms_count;
+    int rooms_count;
+    int created_item_rooms;
+    int created_secret_rooms;
+    int boss_room_found;
+    int shop_room_found;
+    int super_secret_created;
+
+    CellList lists[MAP_LISTS];
+} MapCheckpoint;
+
+MapCheckpoint map_checkpoints[MAP_CHECKPOINTS];
+
+// generator's own random stream, so a floor is reproducible from a full 32bit seed
+// (random_seed() only takes a var, which can't hold more than ~2 million seeds)
+unsigned long map_rng_state = 1;
+
+void map_random_seed(int seed)
+{
+    map_rng_state = seed;
+    if (map_rng_state == 0)
+        map_rng_state = 0x9E3779B9;
+}
+
+// xorshift32, advances the given state
+unsigned long rng_next(unsigned long *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// returns random integer in [0, max) from the given state
+int rng_range(unsigned long *state, int max)
+{
+    if (max <= 0)
+        return 0;
+
+    return (rng_next(state) >> 8) % max;
+}
+
+unsigned long map_random_next()
+{
+    return rng_next(&map_rng_state);
+}
+
+// returns random integer in [0, max)
+int map_random(int max)
+{
+    return rng_range(&map_rng_state, max);
+}
+
+// murmur3 finalizer, used for deriving seeds from other seeds
+unsigned long hash_mix(unsigned long h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+// each attempt gets it's own seed, so attempts don't depend on each other
+int map_attempt_seed(int seed, int attempt)
+{
+    return hash_mix(seed ^ hash_mix(attempt + 0x9E3779B9));
+}
+
+int is_shape_cell(int shape, int x, int y)
+{
+    if (x < 0 || x > 1 || y < 0 || y > 1)
+        return false;
+
+    return (map_shape_rows[shape * 2 + y] & (1 << x)) != 0;
+}
+
+// precomputes size, cells, links and halo of every shape, so placing a shape only takes a few masks
+void map_shapes_init()
+{
+    int shape = 0;
+    for (shape = 0; shape < MAP_SHAPES; shape++)
+    {
+        map_shape_width[shape] = 1;
+        map_shape_height[shape] = 1;
+        map_shape_cell_count[shape] = 0;
+
+        int i = 0;
+        for (i = 0; i < 4; i++)
+            map_shape_halo[shape * 4 + i] = 0;
+
+        int x = 0, y = 0;
+        for (y = 0; y < 2; y++)
+        {
+            for (x = 0; x < 2; x++)
+            {
+                if (!is_shape_cell(shape, x, y))
+                    continue;
+
+                map_shape_width[shape] = maxv(map_shape_width[shape], x + 1);
+                map_shape_height[shape] = maxv(map_shape_height[shape], y + 1);
+
+                int index = shape * MAP_SHAPE_CELLS + map_shape_cell_count[shape];
+                map_shape_cells[index] = x + y * 2;
+                map_shape_links[index] = 0;
+                map_shape_cell_count[shape]++;
+
+                int n = 0;
+                for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+                {
+                    int nx = x + cardinal_dx[n];
+                    int ny = y + cardinal_dy[n];
+
+                    if (is_shape_cell(shape, nx, ny))
+                        map_shape_links[index] |= 1 << n;
+                    else
+                        map_shape_halo[shape * 4 + ny + 1] |= 1 << (nx + 1);
+                }
+            }
+        }
+    }
+}
+
+void map_grid_init()
+{
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT + 2; y++)
+    {
+        for (x = 0; x < MAP_STRIDE; x++)
+        {
+            if (x == 0 || y == 0 || x == MAP_STRIDE - 1 || y == MAP_HEIGHT + 1)
+                map_grid_blank[x + y * MAP_STRIDE] = MAP_GRID_WALL;
+            else
+                map_grid_blank[x + y * MAP_STRIDE] = MAP_GRID_EMPTY;
+        }
+    }
+
+    memcpy(map_grid, map_grid_blank, MAP_GRID_CELLS);
+}
+
+void map_init()
+{
+    map_grid_init();
+    map_shapes_init();
+}
+
+void map_reset_stage_rejections()
+{
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+        map_stage_rejections[i] = 0;
+}
+
+double map_clock_update()
+{
+    map_clock += dtimer();
+    return map_clock;
+}
+
+void map_reset_stage_times()
+{
+    map_timed_stage = MAP_STAGE_NONE;
+
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+        map_stage_time[i] = 0;
+}
+
+// adds time since the last call to the stage that was running and starts timing the given one
+// (time between MAP_STAGE_NONE and the next stage isn't counted anywhere)
+void map_stage_clock(int stage)
+{
+    if (!map_stage_timing)
+        return;
+
+    double now = map_clock_update();
+    if (map_timed_stage != MAP_STAGE_NONE)
+    {
+        map_stage_time[map_timed_stage] += now - map_timed_stage_start;
+        map_floor_stage_time[map_timed_stage] += now - map_timed_stage_start;
+    }
+
+    if (map_stage_counting)
+        map_stage_count(map_timed_stage);
+
+    map_timed_stage = stage;
+    map_timed_stage_start = now;
+}
+
+// starts timing stages of a new floor
+void map_floor_timing_begin()
+{
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+        map_floor_stage_time[i] = 0;
+}
+
+// floor is done, keeps it's stage times as the last floor's ones
+void map_floor_timing_end()
+{
+    if (!map_stage_timing)
+        return;
+
+    map_last_floor_time = 0;
+
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+    {
+        map_last_floor_stage_time[i] = map_floor_stage_time[i];
+        map_last_floor_time += map_floor_stage_time[i];
+    }
+
+    map_last_floor_attempts = map_attempts;
+    map_timed_floor_time[map_timed_floors % MAP_TIMED_FLOORS] = map_last_floor_time;
+    map_timed_floors++;
+}
+
+char *map_stage_name(int stage)
+{
+    switch (stage)
+    {
+    case MAP_STAGE_ROOMS:
+        return "rooms";
+
+    case MAP_STAGE_END_ROOMS:
+        return "end rooms";
+
+    case MAP_STAGE_BOSS_ROOM:
+        return "boss room";
+
+    case MAP_STAGE_SHOP_ROOM:
+        return "shop room";
+
+    case MAP_STAGE_ITEM_ROOMS:
+        return "item rooms";
+
+    case MAP_STAGE_SECRET_POSITIONS:
+        return "secret positions";
+
+    case MAP_STAGE_SECRET_ROOMS:
+        return "secret rooms";
+
+    case MAP_STAGE_SUPER_POSITIONS:
+        return "super secret positions";
+
+    case MAP_STAGE_SUPER_ROOM:
+        return "super secret room";
+    }
+
+    return "unknown";
+}
+
+int map_reject(int stage)
+{
+    map_stage_rejections[stage]++;
+    return false;
+}
+
+int is_in_map(int x, int y)
+{
+    return x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT;
+}
+
+int map_grid_index(int x, int y)
+{
+    return x + 1 + (y + 1) * MAP_STRIDE;
+}
+
+// rooms (or walls) around the given grid cell, straight line code without bounds checks
+int map_grid_neighbours(int index)
+{
+    return map_grid[index - MAP_STRIDE] + map_grid[index + 1] + map_grid[index + MAP_STRIDE] + map_grid[index - 1];
+}
+
+// marks map cell as taken by a room
+void map_occupy(int x, int y)
+{
+    bitboard_set(&map_rooms_board, x, y);
+    map_grid[map_grid_index(x, y)] = MAP_GRID_ROOM;
+}
+
+void snap_to_grid(Vector2d *pos)
+{
+    if (!pos)
+        return;
+
+    pos->x += (MAP_CELL_SIZE / 2) * sign(pos->x);
+    pos->x = (integer(pos->x / MAP_CELL_SIZE) * MAP_CELL_SIZE);
+    pos->y += (MAP_CELL_SIZE / 2) * sign(pos->y);
+    pos->y = (integer(pos->y / MAP_CELL_SIZE) * MAP_CELL_SIZE);
+}
+
+void get_map_center(int *x, int *y)
+{
+    *x = integer(MAP_WIDTH / 2);
+    *y = integer(MAP_HEIGHT / 2);
+}
+
+void reset_tile(Tile *tile, int x, int y)
+{
+    if (!tile)
+        return;
+
+    tile->region = -1;
+    tile->x = x;
+    tile->y = y;
+
+    tile->type = ROOM_NONE;
+
+    tile->doors = 0;
+    tile->top = false;
+    tile->right = false;
+    tile->bottom = false;
+    tile->left = false;
+
+    tile->secret_chance = 0;
+    tile->secret_doors = 0;
+    tile->secret_top = false;
+    tile->secret_right = false;
+    tile->secret_bottom = false;
+    tile->secret_left = false;
+
+    tile->links = 0;
+}
+
+void map_reset()
+{
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+        for (x = 0; x < MAP_WIDTH; x++)
+            reset_tile(&map[x][y], x, y);
+
+    bitboard_clear(&map_rooms_board);
+    memcpy(map_grid, map_grid_blank, MAP_GRID_CELLS);
+    bitboard_clear(&map_end_rooms_board);
+    bitboard_clear(&map_secret_positions_board);
+    bitboard_clear(&map_secret_blocked_board);
+}
+
+void room_create(Tile *tile, int type)
+{
+    if (!tile)
+        return;
+
+    map_list_add(&rooms_queue_list, tile);
+    map_occupy(tile->x, tile->y);
+
+    tile->type = type;
+    tile->region = cell_list_size(&rooms_queue_list);
+    map_rooms_count++;
+}
+
+// creates one room out of all cells of the shape (x, y is it's top left corner)
+// every cell is queued, so the layout can grow out of any of them, and all of them share the region
+void room_create_shaped(int shape, int x, int y, int type)
+{
+    int region = cell_list_size(&rooms_queue_list) + 1;
+
+    int i = 0;
+    for (i = 0; i < map_shape_cell_count[shape]; i++)
+    {
+        int index = shape * MAP_SHAPE_CELLS + i;
+        int cx = x + map_shape_cells[index] % 2;
+        int cy = y + map_shape_cells[index] / 2;
+        Tile *tile = &map[cx][cy];
+
+        map_list_add(&rooms_queue_list, tile);
+        map_occupy(cx, cy);
+
+        tile->type = type;
+        tile->region = region;
+        tile->links = map_shape_links[index];
+    }
+
+    map_rooms_count++;
+}
+
+int count_bordering_rooms(Tile *tile)
+{
+    if (!tile)
+        return false;
+
+    // cells outside of the map count as bordering rooms too (wall ring)
+    return map_grid_neighbours(map_grid_index(tile->x, tile->y));
+}
+
+// fills board with all rooms of the given type
+void map_rooms_board_of_type(Bitboard *board, int type)
+{
+    bitboard_clear(board);
+
+    map_list_enumerate_begin(&rooms_queue_list, v)
+    {
+        if (!v)
+            continue;
+
+        if (v->type != type)
+            continue;
+
+        bitboard_set(board, v->x, v->y);
+    }
+    map_list_enumerate_end(&rooms_queue_list);
+}
+
+// neighbour that can become a new room, without the random chance
+int is_free_grid_cell(int index)
+{
+    if (map_grid[index] != MAP_GRID_EMPTY)
+        return false;
+
+    if (map_grid_neighbours(index) > 1)
+        return false;
+
+    if (map_rooms_count >= max_rooms)
+        return false;
+
+    return true;
+}
+
+int is_free_neighbour(Tile *neighbour)
+{
+    if (!neighbour)
+        return false;
+
+    return is_free_grid_cell(map_grid_index(neighbour->x, neighbour->y));
+}
+
+int is_valid_neighbour(Tile *neighbour)
+{
+    if (!is_free_neighbour(neighbour))
+        return false;
+
+    if (RANDOM_CHANCE(map_grow_skip))
+        return false;
+
+    return true;
+}
+
+// end room candidate of a growing layout (one door and no other rooms or map's edge around)
+// new rooms only border their parent, so a candidate stays one until a room is added to it
+int is_growing_end_room(Tile *tile)
+{
+    if (!tile)
+        return false;
+
+    if (tile->type != ROOM_NORMAL || tile->doors != 1 || tile->links)
+        return false;
+
+    return count_bordering_rooms(tile) <= 1;
+}
+
+// how many end rooms the layout can still lose, every new room adds one end room at most
+int map_end_rooms_slack()
+{
+    int rooms_left = max_rooms - map_rooms_count;
+    return map_end_rooms_count + rooms_left - (2 + max_item_rooms);
+}
+
+// connects tile with the neighbour cell in the given cardinal direction
+void map_add_door(Tile *tile, Tile *neighbour, int n)
+{
+    tile->doors++;
+    neighbour->doors++;
+
+    switch (n)
+    {
+    case CARDINAL_TOP:
+        tile->top = true;
+        neighbour->bottom = true;
+        break;
+
+    case CARDINAL_RIGHT:
+        tile->right = true;
+        neighbour->left = true;
+        break;
+
+    case CARDINAL_BOTTOM:
+        tile->bottom = true;
+        neighbour->top = true;
+        break;
+
+    case CARDINAL_LEFT:
+        tile->left = true;
+        neighbour->right = true;
+        break;
+    }
+}
+
+// adds new room next to the given one (in the given cardinal direction) and connects both
+void map_add_room_next_to(Tile *tile, Tile *neighbour, int n)
+{
+    if (!tile || !neighbour)
+        return;
+
+    if (is_growing_end_room(tile))
+        map_end_rooms_count--;
+
+    map_add_door(tile, neighbour, n);
+
+    room_create(neighbour, ROOM_NORMAL);
+    if (is_growing_end_room(neighbour))
+        map_end_rooms_count++;
+}
+
+// tests if the shape fits with it's top left corner at x, y
+// it can only touch one room (the one it grows out of), and the map's edge counts as a room, same as for single cells
+int is_shape_free(int shape, int x, int y)
+{
+    if (x < 1 || y < 1 || x + map_shape_width[shape] >= MAP_WIDTH || y + map_shape_height[shape] >= MAP_HEIGHT)
+        return false;
+
+    // whole bounding box has to be empty, so L shapes can't wrap around the room they grow out of
+    int box = (1 << map_shape_width[shape]) - 1;
+
+    int i = 0;
+    for (i = 0; i < map_shape_height[shape]; i++)
+    {
+        if ((map_rooms_board.row[y + i] >> x) & box)
+            return false;
+    }
+
+    int touching = 0;
+    for (i = 0; i < map_shape_height[shape] + 2; i++)
+        touching += popcount32((map_rooms_board.row[y - 1 + i] >> (x - 1)) & map_shape_halo[shape * 4 + i]);
+
+    return touching == 1;
+}
+
+// same as map_add_room_next_to, but the new room gets a random bigger shape (neighbour becomes one of it's cells)
+// returns false if shapes are off, the roll failed or the shape doesn't fit (nothing is added then)
+int map_add_shaped_room_next_to(Tile *tile, Tile *neighbour, int n)
+{
+    if (!tile || !neighbour)
+        return false;
+
+    if (map_room_shapes <= 0)
+        return false;
+
+    if (map_random(map_room_shapes) != 0)
+        return false;
+
+    int shape = 1 + map_random(MAP_SHAPES - 1);
+    int cell = map_shape_cells[shape * MAP_SHAPE_CELLS + map_random(map_shape_cell_count[shape])];
+    int x = neighbour->x - cell % 2;
+    int y = neighbour->y - cell / 2;
+    if (!is_shape_free(shape, x, y))
+        return false;
+
+    // bigger rooms are never end rooms, so they don't add any
+    if (is_growing_end_room(tile))
+        map_end_rooms_count--;
+
+    map_add_door(tile, neighbour, n);
+    room_create_shaped(shape, x, y, ROOM_NORMAL);
+    return true;
+}
+
+// picks random free neighbour of the tile, returns it's cardinal direction or -1 if there is none
+int map_random_free_direction(Tile *tile)
+{
+    if (!tile)
+        return -1;
+
+    int free_dir[CARDINAL_DIRECTIONS];
+    int free_count = 0;
+    int index = map_grid_index(tile->x, tile->y);
+
+    int n = 0;
+    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    {
+        if (!is_free_grid_cell(index + cardinal_grid_offset[n]))
+            continue;
+
+        free_dir[free_count] = n;
+        free_count++;
+    }
+
+    if (free_count <= 0)
+        return -1;
+
+    return free_dir[map_random(free_count)];
+}
+
+// queue ran out before max_rooms were placed, so the layout would be thrown away
+// instead one more room is added to a random room that still has space around it
+// (end rooms are left alone when there are no end rooms to spare)
+void map_revive_growth()
+{
+    int size = cell_list_size(&rooms_queue_list);
+    if (size <= 0 || map_rooms_count >= max_rooms)
+        return;
+
+    int offset = map_random(size);
+
+    int i = 0;
+    for (i = 0; i < size; i++)
+    {
+        Tile *tile = map_list_get_at(&rooms_queue_list, (offset + i) % size);
+        if (!tile)
+            continue;
+
+        if (map_end_rooms_slack() <= 0 && is_growing_end_room(tile))
+            continue;
+
+        int n = map_random_free_direction(tile);
+        if (n < 0)
+            continue;
+
+        map_add_room_next_to(tile, &map[tile->x + cardinal_dx[n]][tile->y + cardinal_dy[n]], n);
+        return;
+    }
+}
+
+// adds starting room to the queue, returns false if map has no center
+int map_add_start_room()
+{
+    int start_x = -1, start_y = -1;
+    get_map_center(&start_x, &start_y);
+    if (!is_in_map(start_x, start_y))
+        return false;
+
+    room_create(&map[start_x][start_y], ROOM_START);
+    return true;
+}
+
+// grows the layout out of the queued room at the given index
+// returns false once the layout doesn't need to grow any further
+int map_grow_room(int queue_index)
+{
+    Tile *v = map_list_get_at(&rooms_queue_list, queue_index);
+    if (!v)
+        return true;
+
+    // not enough end rooms possible anymore, no need to grow this layout any further
+    if (map_end_rooms_slack() < 0)
+        return false;
+
+    // growing out of an end room only moves it, so don't do that when there are no end rooms to spare
+    int directions = CARDINAL_DIRECTIONS;
+    if (map_end_rooms_slack() <= 0 && is_growing_end_room(v))
+        directions = 0;
+
+    int index = map_grid_index(v->x, v->y);
+
+    int n = 0;
+    for (n = 0; n < directions; n++)
+    {
+        // rooms and the wall ring are never free, so the neighbour can't be outside of the map after this
+        if (map_grid[index + cardinal_grid_offset[n]] != MAP_GRID_EMPTY)
+            continue;
+
+        Tile *neighbour = &map[v->x + cardinal_dx[n]][v->y + cardinal_dy[n]];
+        if (!is_valid_neighbour(neighbour))
+            continue;
+
+        if (!map_add_shaped_room_next_to(v, neighbour, n))
+            map_add_room_next_to(v, neighbour, n);
+    }
+
+    if (map_revive && queue_index == cell_list_size(&rooms_queue_list) - 1)
+        map_revive_growth();
+
+    return true;
+}
+
+void map_add_rooms()
+{
+    if (!map_add_start_room())
+        return;
+
+    // cycle though the queue, it grows while it's being cycled through
+    int i = 0;
+    for (i = 0; i < cell_list_size(&rooms_queue_list); i++)
+    {
+        if (!map_grow_room(i))
+            break;
+    }
+}
+
+void map_find_end_rooms()
+{
+    // rooms that border more than one room (or map's edge) at once
+    Bitboard planes[BITBOARD_COUNT_PLANES];
+    Bitboard crowded;
+    bitboard_neighbour_counts(&map_rooms_board, true, planes);
+    bitboard_count_at_least_two(&crowded, planes);
+
+    map_list_enumerate_begin(&rooms_queue_list, v)
+    {
+        if (!v)
+            continue;
+
+        if (v->type != ROOM_NORMAL)
+            continue;
+
+        if (v->doors > 1)
+            continue;
+
+        // rooms bigger than one cell are never end rooms
+        if (v->links)
+            continue;
+
+        if (bitboard_test(&crowded, v->x, v->y))
+            continue;
+
+        map_list_add(&end_rooms_list, v);
+        bitboard_set(&map_end_rooms_board, v->x, v->y);
+    }
+    map_list_enumerate_end(&rooms_queue_list);
+}
+
+// counts a pick that ties with the best one so far, returns true if it should replace it
+// by default the last one wins, random picks give every tied room the same chance
+int map_pick_tie(int *ties)
+{
+    (*ties)++;
+    if (!map_random_picks)
+        return true;
+
+    return map_random(*ties) == 0;
+}
+
+var get_distance(int x1, int y1, int x2, int y2)
+{
+    VECTOR start, end;
+    vec_set(&start, vector(x1 * MAP_CELL_SIZE, y1 * MAP_CELL_SIZE, 0));
+    vec_set(&end, vector(x2 * MAP_CELL_SIZE, y2 * MAP_CELL_SIZE, 0));
+    return vec_dist(&start, &end);
+}
+
+void map_find_boss_room()
+{
+    int x = -1, y = -1, ties = 0;
+    var farthest_distance = 0;
+
+    int start_x = -1, start_y = -1;
+    get_map_center(&start_x, &start_y);
+    if (!is_in_map(start_x, start_y))
+        return;
+
+    map_list_enumerate_begin(&end_rooms_list, v)
+    {
+        if (!v)
+            continue;
+
+        var dist = get_distance(v->x, v->y, start_x, start_y);
+        if (dist < farthest_distance)
+            continue;
+
+        if (dist > farthest_distance)
+            ties = 0;
+
+        if (!map_pick_tie(&ties))
+            continue;
+
+        x = v->x;
+        y = v->y;
+        farthest_distance = dist;
+    }
+    map_list_enumerate_end(&end_rooms_list);
+
+    if (x != -1 && y != -1)
+        boss_room_found = true;
+
+    if (boss_room_found == true)
+        map[x][y].type = ROOM_BOSS;
+}
+
+void map_find_shop_room()
+{
+    int start_x = -1, start_y = -1;
+    get_map_center(&start_x, &start_y);
+    if (!is_in_map(start_x, start_y))
+        return;
+
+    int x = -1, y = -1, ties = 0;
+    Tile *temp_tile = map_list_get_at(&end_rooms_list, 0);
+    if (!temp_tile)
+        return;
+
+    var closest_distance = get_distance(temp_tile->x, temp_tile->y, start_x, start_y);
+
+    map_list_enumerate_begin(&end_rooms_list, v)
+    {
+        if (!v)
+            continue;
+
+        if (v->type != ROOM_NORMAL)
+            continue;
+
+        var dist = get_distance(v->x, v->y, start_x, start_y);
+        if (dist > closest_distance)
+            continue;
+
+        if (dist < closest_distance)
+            ties = 0;
+
+        if (!map_pick_tie(&ties))
+            continue;
+
+        x = v->x;
+        y = v->y;
+        closest_distance = dist;
+    }
+    map_list_enumerate_end(&end_rooms_list);
+
+    if (x != -1 && y != -1)
+        shop_room_found = true;
+
+    if (shop_room_found == true)
+        map[x][y].type = ROOM_SPECIAL;
+}
+
+void map_find_item_rooms()
+{
+    while (created_item_rooms < max_item_rooms)
+    {
+        // first free end room, or a random one if picks are random
+        Tile *item_room = NULL;
+        int candidates = 0;
+
+        map_list_enumerate_begin(&end_rooms_list, v)
+        {
+            if (!v)
+                continue;
+
+            if (v->type != ROOM_NORMAL)
+                continue;
+
+            candidates++;
+            if (!item_room)
+                item_room = v;
+            else if (map_random_picks)
+            {
+                if (map_random(candidates) == 0)
+                    item_room = v;
+            }
+        }
+        map_list_enumerate_end(&end_rooms_list);
+
+        if (!item_room)
+            break;
+
+        item_room->type = ROOM_LOCKED;
+        created_item_rooms++;
+    }
+}
+
+void map_find_secret_positions()
+{
+    // secret chance is the amount of bordering rooms that aren't start or boss room
+    Bitboard sources, boss_rooms, normal_rooms;
+    map_rooms_board_of_type(&boss_rooms, ROOM_BOSS);
+    map_rooms_board_of_type(&normal_rooms, ROOM_NORMAL);
+    map_rooms_board_of_type(&sources, ROOM_START);
+    bitboard_or(&sources, &sources, &boss_rooms);
+    bitboard_and_not(&sources, &map_rooms_board, &sources);
+
+    bitboard_neighbour_counts(&sources, false, map_secret_chance_planes);
+
+    // secret room can go into any empty cell next to a normal room, as long as it doesn't touch the boss room
+    Bitboard empty, near_normal, near_boss;
+    bitboard_not(&empty, &map_rooms_board);
+    bitboard_dilate(&near_normal, &normal_rooms);
+    bitboard_dilate(&near_boss, &boss_rooms);
+
+    bitboard_and(&map_secret_positions_board, &empty, &near_normal);
+    bitboard_and_not(&map_secret_positions_board, &map_secret_positions_board, &near_boss);
+
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (x = 0; x < MAP_WIDTH; x++)
+        {
+            if (!bitboard_test(&empty, x, y))
+                continue;
+
+            map[x][y].secret_chance = bitboard_count_at(map_secret_chance_planes, x, y);
+
+            if (!bitboard_test(&map_secret_positions_board, x, y))
+                continue;
+
+            map_list_add(&secret_positions_list, &map[x][y]);
+        }
+    }
+}
+
+int is_secret_already_added(Tile *tile)
+{
+    if (!tile)
+        return false;
+
+    int found = false;
+    map_list_enumerate_begin(&secret_rooms_list, v)
+    {
+        if (!v)
+            continue;
+
+        if (found)
+            break;
+
+        if (v->x == tile->x && v->y == tile->y)
+            found = true;
+    }
+    map_list_enumerate_end(&secret_rooms_list);
+
+    return found;
+}
+
+int is_valid_secret_neighbour(Tile *tile)
+{
+    if (!tile)
+        return false;
+
+    if (tile->type == ROOM_NONE || tile->type == ROOM_BOSS || tile->type == ROOM_SECRET || tile->type == ROOM_SUPER_SECRET)
+        return false;
+
+    return true;
+}
+
+void map_add_secret_rooms()
+{
+    // every pass adds one position (or none is left), so there can't be more passes than positions
+    int passes = cell_list_size(&secret_positions_list);
+    while (passes > 0 && cell_list_size(&secret_rooms_list) < max_secrets)
+    {
+        passes--;
+
+        int highest_chance = 0, x = -1, y = -1, ties = 0;
+        map_list_enumerate_begin(&secret_positions_list, v)
+        {
+            if (!v)
+                continue;
+
+            if (v->type != ROOM_NONE)
+                continue;
+
+            if (v->secret_chance < highest_chance)
+                continue;
+
+            if (bitboard_test(&map_secret_blocked_board, v->x, v->y))
+                continue;
+
+            if (is_secret_already_added(v))
+                continue;
+
+            if (v->secret_chance > highest_chance)
+                ties = 0;
+
+            if (!map_pick_tie(&ties))
+                continue;
+
+            x = v->x;
+            y = v->y;
+            highest_chance = v->secret_chance;
+        }
+        map_list_enumerate_end(&secret_positions_list);
+
+        if (x == -1 || y == -1)
+            break;
+
+        map_list_add(&secret_rooms_list, &map[x][y]);
+    }
+
+    map_list_enumerate_begin(&secret_rooms_list, v)
+    {
+        if (!v)
+            continue;
+
+        v->type = ROOM_SECRET;
+        v->region = 0;
+        map_occupy(v->x, v->y);
+
+        int x = v->x;
+        int y = v->y;
+
+        // regions the secret room already has a door into, bigger rooms only get one secret door
+        int opened[CARDINAL_DIRECTIONS];
+        int opened_count = 0;
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            int nx = x + cardinal_dx[n];
+            int ny = y + cardinal_dy[n];
+            if (!is_in_map(nx, ny))
+                continue;
+
+            Tile *neighbour = &map[nx][ny];
+            if (!neighbour)
+                continue;
+
+            if (!is_valid_secret_neighbour(neighbour))
+                continue;
+
+            int i = 0, is_opened = false;
+            for (i = 0; i < opened_count; i++)
+            {
+                if (opened[i] == neighbour->region)
+                    is_opened = true;
+            }
+
+            if (is_opened)
+                continue;
+
+            opened[opened_count] = neighbour->region;
+            opened_count++;
+
+            v->doors++;
+            neighbour->secret_doors++;
+
+            switch (n)
+            {
+            case CARDINAL_TOP:
+                neighbour->secret_bottom = true;
+                v->top = true;
+                break;
+
+            case CARDINAL_RIGHT:
+                neighbour->secret_left = true;
+                v->right = true;
+                break;
+
+            case CARDINAL_BOTTOM:
+                neighbour->secret_top = true;
+                v->bottom = true;
+                break;
+
+            case CARDINAL_LEFT:
+                neighbour->secret_right = true;
+                v->left = true;
+                break;
+            }
+        }
+
+        created_secret_rooms++;
+        if (created_secret_rooms >= max_secrets)
+            break;
+    }
+    map_list_enumerate_end(&secret_rooms_list);
+}
+
+int is_valid_super_secret_neighbour(Tile *tile)
+{
+    if (!tile)
+        return false;
+}
+
+// secret positions with secret chance of 1, that don't border more than one room (or map's edge)
+// and border at least one normal room
+void map_super_secret_candidates(Bitboard *candidates)
+{
+    Bitboard planes[BITBOARD_COUNT_PLANES];
+    Bitboard crowded, normal_rooms, near_normal;
+    bitboard_neighbour_counts(&map_rooms_board, true, planes);
+    bitboard_count_at_least_two(&crowded, planes);
+
+    map_rooms_board_of_type(&normal_rooms, ROOM_NORMAL);
+    bitboard_dilate(&near_normal, &normal_rooms);
+
+    bitboard_count_exactly_one(candidates, map_secret_chance_planes);
+    bitboard_and(candidates, candidates, &map_secret_positions_board);
+    bitboard_and(candidates, candidates, &near_normal);
+    bitboard_and_not(candidates, candidates, &crowded);
+}
+
+void map_add_super_secret_positions()
+{
+    Bitboard candidates;
+    map_super_secret_candidates(&candidates);
+
+    map_list_enumerate_begin(&secret_positions_list, v)
+    {
+        if (!v)
+            continue;
+
+        if (!bitboard_test(&candidates, v->x, v->y))
+            continue;
+
+        // secret rooms are placed by now, they can't be taken over
+        if (v->type != ROOM_NONE)
+            continue;
+
+        map_list_add(&super_positions_list, v);
+    }
+    map_list_enumerate_end(&secret_positions_list);
+}
+
+void map_add_super_secret_room()
+{
+    int index = RANDOM_RANGE(0, cell_list_size(&super_positions_list));
+    Tile *super_secret_room = map_list_get_at(&super_positions_list, index);
+    if (!super_secret_room)
+        return;
+
+    super_secret_room->type = ROOM_SUPER_SECRET;
+    super_secret_room->region = 0;
+    map_occupy(super_secret_room->x, super_secret_room->y);
+
+    int x = super_secret_room->x;
+    int y = super_secret_room->y;
+
+    int n = 0, counter = 0;
+    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    {
+        int nx = x + cardinal_dx[n];
+        int ny = y + cardinal_dy[n];
+        if (!is_in_map(nx, ny))
+            continue;
+
+        Tile *neighbour = &map[nx][ny];
+        if (!neighbour)
+            continue;
+
+        if (neighbour->type != ROOM_NORMAL)
+            continue;
+
+        super_secret_room->doors++;
+        neighbour->secret_doors++;
+
+        switch (n)
+        {
+        case CARDINAL_TOP:
+            neighbour->secret_bottom = true;
+            super_secret_room->top = true;
+            break;
+
+        case CARDINAL_RIGHT:
+            neighbour->secret_left = true;
+            super_secret_room->right = true;
+            break;
+
+        case CARDINAL_BOTTOM:
+            neighbour->secret_top = true;
+            super_secret_room->bottom = true;
+            break;
+
+        case CARDINAL_LEFT:
+            neighbour->secret_right = true;
+            super_secret_room->left = true;
+            break;
+        }
+    }
+}
+
+void map_roll_params()
+{
+    max_rooms = RANDOM_RANGE(0, map_rooms_spread) + map_rooms_base + (int)minv(level_id, max_level_id) * map_rooms_per_level / 10;
+
+    if (level_id == 0)
+    {
+        max_secrets = 1;
+        max_item_rooms = 1;
+    }
+    else
+    {
+        max_secrets = RANDOM_RANGE(0, map_secrets_spread) + map_secrets_min;
+        max_item_rooms = RANDOM_RANGE(0, map_item_rooms_spread) + map_item_rooms_min;
+    }
+}
+
+// clears the map and the working lists before the new attempt
+void map_clear()
+{
+    map_end_rooms_count = 0;
+    map_rooms_count = 0;
+    created_item_rooms = 0;
+    created_secret_rooms = 0;
+
+    boss_room_found = false;
+    shop_room_found = false;
+    super_secret_created = false;
+
+    map_reset();
+
+    cell_list_clear(&rooms_queue_list);
+    cell_list_clear(&end_rooms_list);
+    cell_list_clear(&secret_positions_list);
+    cell_list_clear(&secret_rooms_list);
+    cell_list_clear(&super_positions_list);
+}
+
+CellList *map_checkpoint_list(int index)
+{
+    switch (index)
+    {
+    case 0:
+        return &rooms_queue_list;
+
+    case 1:
+        return &end_rooms_list;
+
+    case 2:
+        return &secret_positions_list;
+
+    case 3:
+        return &secret_rooms_list;
+    }
+
+    return &super_positions_list;
+}
+
+// stores the given map columns (bit per column) and all of the other state
+void map_checkpoint_save_columns(MapCheckpoint *checkpoint, int columns)
+{
+    if (!checkpoint)
+        return;
+
+    checkpoint->columns = columns;
+
+    int i = 0;
+    for (i = 0; i < MAP_WIDTH; i++)
+    {
+        if (checkpoint->columns & (1 << i))
+            memcpy(checkpoint->tiles[i], map[i], sizeof(Tile) * MAP_HEIGHT);
+    }
+
+    bitboard_copy(&checkpoint->rooms_board, &map_rooms_board);
+    memcpy(checkpoint->grid, map_grid, MAP_GRID_CELLS);
+    bitboard_copy(&checkpoint->end_rooms_board, &map_end_rooms_board);
+    bitboard_copy(&checkpoint->secret_positions_board, &map_secret_positions_board);
+
+    for (i = 0; i < BITBOARD_COUNT_PLANES; i++)
+        bitboard_copy(&checkpoint->secret_chance_planes[i], &map_secret_chance_planes[i]);
+
+    checkpoint->end_rooms_count = map_end_rooms_count;
+    checkpoint->rooms_count = map_rooms_count;
+    checkpoint->created_item_rooms = created_item_rooms;
+    checkpoint->created_secret_rooms = created_secret_rooms;
+    checkpoint->boss_room_found = boss_room_found;
+    checkpoint->shop_room_found = shop_room_found;
+    checkpoint->super_secret_created = super_secret_created;
+
+    for (i = 0; i < MAP_LISTS; i++)
+        cell_list_copy(&checkpoint->lists[i], map_checkpoint_list(i));
+
+    checkpoint->valid = true;
+}
+
+void map_checkpoint_save(MapCheckpoint *checkpoint)
+{
+    Bitboard reach;
+    bitboard_dilate(&reach, &map_rooms_board);
+    bitboard_or(&reach, &reach, &map_rooms_board);
+
+    int columns = 0;
+
+    int i = 0;
+    for (i = 0; i < MAP_HEIGHT; i++)
+        columns |= reach.row[i];
+
+    map_checkpoint_save_columns(checkpoint, columns);
+}
+
+void map_checkpoint_restore(MapCheckpoint *checkpoint)
+{
+    if (!checkpoint)
+        return;
+
+    if (!checkpoint->valid)
+        return;
+
+    int i = 0;
+    for (i = 0; i < MAP_WIDTH; i++)
+    {
+        if (checkpoint->columns & (1 << i))
+            memcpy(map[i], checkpoint->tiles[i], sizeof(Tile) * MAP_HEIGHT);
+    }
+
+    bitboard_copy(&map_rooms_board, &checkpoint->rooms_board);
+    memcpy(map_grid, checkpoint->grid, MAP_GRID_CELLS);
+    bitboard_copy(&map_end_rooms_board, &checkpoint->end_rooms_board);
+    bitboard_copy(&map_secret_positions_board, &checkpoint->secret_positions_board);
+    bitboard_clear(&map_secret_blocked_board);
+
+    for (i = 0; i < BITBOARD_COUNT_PLANES; i++)
+        bitboard_copy(&map_secret_chance_planes[i], &checkpoint->secret_chance_planes[i]);
+
+    map_end_rooms_count = checkpoint->end_rooms_count;
+    map_rooms_count = checkpoint->rooms_count;
+    created_item_rooms = checkpoint->created_item_rooms;
+    created_secret_rooms = checkpoint->created_secret_rooms;
+    boss_room_found = checkpoint->boss_room_found;
+    shop_room_found = checkpoint->shop_room_found;
+    super_secret_created = checkpoint->super_secret_created;
+
+    for (i = 0; i < MAP_LISTS; i++)
+        cell_list_copy(map_checkpoint_list(i), &checkpoint->lists[i]);
+}
+
+// whole generator state (all map columns, checkpoints, random stream and params)
+// so generating a floor can be put aside while the map is used for something else, and picked up again later
+typedef struct MapContext
+{
+    MapCheckpoint state;
+    MapCheckpoint checkpoints[MAP_CHECKPOINTS];
+
+    unsigned long rng_state;
+    int seed;
+    int level_id;
+    int attempts;
+    int max_rooms;
+    int max_secrets;
+    int max_item_rooms;
+
+    double floor_stage_time[MAP_STAGES];
+} MapContext;
+
+void map_context_save(MapContext *context)
+{
+    if (!context)
+        return;
+
+    map_checkpoint_save_columns(&context->state, (1 << MAP_WIDTH) - 1);
+    memcpy(context->checkpoints, map_checkpoints, sizeof(MapCheckpoint) * MAP_CHECKPOINTS);
+
+    context->rng_state = map_rng_state;
+    context->seed = map_seed;
+    context->level_id = map_level_id;
+    context->attempts = map_attempts;
+    context->max_rooms = max_rooms;
+    context->max_secrets = max_secrets;
+    context->max_item_rooms = max_item_rooms;
+
+    memcpy(context->floor_stage_time, map_floor_stage_time, sizeof(double) * MAP_STAGES);
+}
+
+void map_context_restore(MapContext *context)
+{
+    if (!context)
+        return;
+
+    map_checkpoint_restore(&context->state);
+    memcpy(map_checkpoints, context->checkpoints, sizeof(MapCheckpoint) * MAP_CHECKPOINTS);
+
+    map_rng_state = context->rng_state;
+    map_seed = context->seed;
+    map_level_id = context->level_id;
+    map_attempts = context->attempts;
+    max_rooms = context->max_rooms;
+    max_secrets = context->max_secrets;
+    max_item_rooms = context->max_item_rooms;
+
+    memcpy(map_floor_stage_time, context->floor_stage_time, sizeof(double) * MAP_STAGES);
+}
+
+// boss, shop and item rooms, end rooms have to be found already
+int map_place_special_rooms()
+{
+    map_stage_clock(MAP_STAGE_BOSS_ROOM);
+    map_find_boss_room();
+    if (!boss_room_found)
+        return map_reject(MAP_STAGE_BOSS_ROOM);
+
+    map_stage_clock(MAP_STAGE_SHOP_ROOM);
+    map_find_shop_room();
+    if (!shop_room_found)
+        return map_reject(MAP_STAGE_SHOP_ROOM);
+
+    map_stage_clock(MAP_STAGE_ITEM_ROOMS);
+    map_find_item_rooms();
+    return true;
+}
+
+// keeps secret rooms away from one random super secret candidate, so it stays free
+// returns false if there aren't enough secret positions left around it
+int map_reserve_super_secret(Bitboard *candidates)
+{
+    int count = bitboard_popcount(candidates);
+    if (count <= 0)
+        return false;
+
+    int pick = map_random(count);
+
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (x = 0; x < MAP_WIDTH; x++)
+        {
+            if (!bitboard_test(candidates, x, y))
+                continue;
+
+            pick--;
+            if (pick >= 0)
+                continue;
+
+            Bitboard reserved;
+            bitboard_clear(&reserved);
+            bitboard_set(&reserved, x, y);
+            bitboard_dilate(&map_secret_blocked_board, &reserved);
+            bitboard_or(&map_secret_blocked_board, &map_secret_blocked_board, &reserved);
+
+            Bitboard free_positions;
+            bitboard_and_not(&free_positions, &map_secret_positions_board, &map_secret_blocked_board);
+            return bitboard_popcount(&free_positions) >= max_secrets;
+        }
+    }
+
+    return false;
+}
+
+// secret rooms and super secret room, from the secrets checkpoint
+// if secrets took all the space the super secret room needs, they are placed again (keeping one candidate free)
+int map_place_secret_rooms()
+{
+    MapCheckpoint *checkpoint = &map_checkpoints[MAP_CHECKPOINT_SECRETS];
+    map_stage_clock(MAP_STAGE_SECRET_ROOMS);
+
+    Bitboard candidates;
+    map_super_secret_candidates(&candidates);
+
+    int retry = 0;
+    for (retry = 0; retry <= MAP_SECRET_RETRIES; retry++)
+    {
+        if (retry > 0)
+        {
+            map_checkpoint_restore(checkpoint);
+            if (!map_reserve_super_secret(&candidates))
+                continue;
+        }
+
+        map_add_secret_rooms();
+        if (created_secret_rooms != max_secrets)
+            return map_reject(MAP_STAGE_SECRET_ROOMS);
+
+        map_stage_clock(MAP_STAGE_SUPER_POSITIONS);
+        map_add_super_secret_positions();
+        if (cell_list_size(&super_positions_list) > 0)
+        {
+            map_stage_clock(MAP_STAGE_SUPER_ROOM);
+            map_add_super_secret_room();
+            return true;
+        }
+
+        map_stage_clock(MAP_STAGE_SECRET_ROOMS);
+    }
+
+    return map_reject(MAP_STAGE_SUPER_POSITIONS);
+}
+
+// secret positions and the secrets checkpoint
+int map_find_secrets()
+{
+    map_stage_clock(MAP_STAGE_SECRET_POSITIONS);
+    map_find_secret_positions();
+    if (cell_list_size(&secret_positions_list) < max_secrets)
+        return map_reject(MAP_STAGE_SECRET_POSITIONS);
+
+    // secret rooms only take space away, so without candidates now there won't be any later
+    Bitboard candidates;
+    map_super_secret_candidates(&candidates);
+    if (bitboard_popcount(&candidates) <= 0)
+        return map_reject(MAP_STAGE_SUPER_POSITIONS);
+
+    map_checkpoint_save(&map_checkpoints[MAP_CHECKPOINT_SECRETS]);
+    return true;
+}
+
+// end rooms and the specials checkpoint
+int map_collect_end_rooms()
+{
+    map_stage_clock(MAP_STAGE_END_ROOMS);
+    map_find_end_rooms();
+    if (cell_list_size(&end_rooms_list) < 2 + max_item_rooms)
+        return map_reject(MAP_STAGE_END_ROOMS);
+
+    map_checkpoint_save(&map_checkpoints[MAP_CHECKPOINT_SPECIALS]);
+    return true;
+}
+
+// runs all the stages that come after the layout is grown
+int map_generate_finish()
+{
+    if (!map_collect_end_rooms())
+        return false;
+
+    if (!map_place_special_rooms())
+        return false;
+
+    if (!map_find_secrets())
+        return false;
+
+    return map_place_secret_rooms();
+}
+
+// rolls params of a new attempt and clears the map, attempt's random seed has to be set already
+void map_start_attempt()
+{
+    map_stage_clock(MAP_STAGE_ROOMS);
+    map_roll_params();
+    map_clear();
+}
+
+// grown layout has to have space for all end rooms and all of it's rooms
+int map_check_layout()
+{
+    if (map_end_rooms_slack() < 0)
+        return map_reject(MAP_STAGE_END_ROOMS);
+
+    if (map_rooms_count != max_rooms)
+        return map_reject(MAP_STAGE_ROOMS);
+
+    return true;
+}
+
+int map_generate_attempt()
+{
+    map_start_attempt();
+    map_add_rooms();
+    if (!map_check_layout())
+        return false;
+
+    return map_generate_finish();
+}
+
+// generates floor from the given seed, without yielding
+// every rejected attempt restarts with the next attempt seed
+void map_generate_seeded(int seed)
+{
+    if ((MAP_WIDTH % 2) == false || (MAP_HEIGHT % 2) == false)
+        return;
+
+    map_seed = seed;
+    map_level_id = level_id;
+    map_attempts = 0;
+    map_floor_timing_begin();
+
+    while (true)
+    {
+        map_random_seed(map_attempt_seed(seed, map_attempts));
+        map_attempts++;
+
+        if (map_generate_attempt())
+            break;
+    }
+
+    map_stage_clock(MAP_STAGE_NONE);
+    map_floor_timing_end();
+}
+
+// same as map_generate_seeded, but for the given level id (current level id is kept)
+void map_generate_level(int seed, int level)
+{
+    int old_level_id = level_id;
+    level_id = level;
+
+    map_generate_seeded(seed);
+
+    level_id = old_level_id;
+}
+
+// rolls later stages of the current floor again, starting from the given checkpoint
+// room picks are random, so every seed gives a variant of the same layout (it's not reproducible from map_seed though)
+// if no variant works out, the floor stays as it was and false is returned
+MapCheckpoint map_reroll_backup;
+MapCheckpoint map_reroll_secrets_backup;
+
+int map_reroll(int checkpoint_index, int seed)
+{
+    int index = clamp(checkpoint_index, 0, MAP_CHECKPOINTS - 1);
+    MapCheckpoint *checkpoint = &map_checkpoints[index];
+    if (!checkpoint->valid)
+        return false;
+
+    // rerolling special rooms writes a new secrets checkpoint too
+    map_checkpoint_save(&map_reroll_backup);
+    memcpy(&map_reroll_secrets_backup, &map_checkpoints[MAP_CHECKPOINT_SECRETS], sizeof(MapCheckpoint));
+    map_random_picks = true;
+
+    int done = false;
+
+    int i = 0;
+    for (i = 0; i < MAP_REROLL_TRIES && !done; i++)
+    {
+        map_random_seed(map_attempt_seed(seed, i));
+        map_checkpoint_restore(checkpoint);
+
+        if (index == MAP_CHECKPOINT_SPECIALS)
+        {
+            if (!map_place_special_rooms())
+                continue;
+
+            if (!map_find_secrets())
+                continue;
+        }
+
+        done = map_place_secret_rooms();
+    }
+
+    map_random_picks = false;
+    map_stage_clock(MAP_STAGE_NONE);
+
+    if (!done)
+    {
+        map_checkpoint_restore(&map_reroll_backup);
+        memcpy(&map_checkpoints[MAP_CHECKPOINT_SECRETS], &map_reroll_secrets_backup, sizeof(MapCheckpoint));
+    }
+
+    return done;
+}
+
+// new boss, shop, item and secret rooms for the current layout
+int map_reroll_specials(int seed)
+{
+    return map_reroll(MAP_CHECKPOINT_SPECIALS, seed);
+}
+
+// new secret rooms for the current layout, special rooms stay
+int map_reroll_secrets(int seed)
+{
+    return map_reroll(MAP_CHECKPOINT_SECRETS, seed);
+}
+
+int map_random_floor_seed()
+{
+    return ((int)random(65536) << 16) | (int)random(65536);
+}
+
+#include "floor.c"
+#include "floor_nav.c"
+#include "map_hash.c"
+#include "floor_check.c"
+#include "map_fuzz.c"
+#include "map_job.c"
+#include "map_run.c"
+#include "map_server.c"
+#include "map_search.c"
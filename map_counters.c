@@ -0,0 +1,100 @@
+// hardware counters per generation stage, read in map_stage_clock while map_stage_counting (and map_stage_timing) is on
+// Lite-C scripts only run on windows, there is no perf_event_open (linux) to open cycles, instructions, cache and branch miss counters with,
+// and windows only gives the last four to kernel drivers, so cycles of the current thread are the only counter that can be read from here
+// counters that can't be read are marked as unavailable, so reports can say so instead of showing zeros
+#include <windows.h>
+
+long WINAPI QueryThreadCycleTime(HANDLE thread, long *cycles);
+#define PRAGMA_API QueryThreadCycleTime;kernel32!QueryThreadCycleTime
+
+#define MAP_COUNTER_CYCLES 0
+#define MAP_COUNTER_INSTRUCTIONS 1
+#define MAP_COUNTER_L1_MISSES 2
+#define MAP_COUNTER_LLC_MISSES 3
+#define MAP_COUNTER_BRANCH_MISSES 4
+#define MAP_COUNTERS 5
+
+int map_stage_counting = false;
+
+// counters that were read fine the last time (map_counters_any is true if there is at least one)
+int map_counter_available[MAP_COUNTERS];
+int map_counters_any = false;
+
+// counter values at the start of the stage being timed, and counts of each stage (never reset by the generator itself)
+double map_counters_start[MAP_COUNTERS];
+double map_stage_counter[MAP_STAGES * MAP_COUNTERS];
+
+void map_reset_stage_counters()
+{
+    int i = 0;
+    for (i = 0; i < MAP_STAGES * MAP_COUNTERS; i++)
+        map_stage_counter[i] = 0;
+}
+
+// reads all counters into values, returns false if none of them could be read
+int map_counters_read(double *values)
+{
+    if (!values)
+        return false;
+
+    int i = 0;
+    for (i = 0; i < MAP_COUNTERS; i++)
+    {
+        values[i] = 0;
+        map_counter_available[i] = false;
+    }
+
+    // 64bit cycle count, low word first
+    long cycles[2];
+    cycles[0] = 0;
+    cycles[1] = 0;
+
+    if (QueryThreadCycleTime(GetCurrentThread(), cycles))
+    {
+        values[MAP_COUNTER_CYCLES] = (unsigned long)cycles[1] * 4294967296.0 + (unsigned long)cycles[0];
+        map_counter_available[MAP_COUNTER_CYCLES] = true;
+    }
+
+    map_counters_any = map_counter_available[MAP_COUNTER_CYCLES];
+    return map_counters_any;
+}
+
+// adds counts since the last call to the given stage (MAP_STAGE_NONE only starts counting)
+void map_stage_count(int stage)
+{
+    double now[MAP_COUNTERS];
+    if (!map_counters_read(now))
+        return;
+
+    int i = 0;
+    for (i = 0; i < MAP_COUNTERS; i++)
+    {
+        if (stage != MAP_STAGE_NONE)
+            map_stage_counter[stage * MAP_COUNTERS + i] += now[i] - map_counters_start[i];
+
+        map_counters_start[i] = now[i];
+    }
+}
+
+char *map_counter_name(int counter)
+{
+    switch (counter)
+    {
+    case MAP_COUNTER_CYCLES:
+        return "cycles";
+
+    case MAP_COUNTER_INSTRUCTIONS:
+        return "instructions";
+
+    case MAP_COUNTER_L1_MISSES:
+        return "l1 misses";
+
+    case MAP_COUNTER_LLC_MISSES:
+        return "llc misses";
+
+    case MAP_COUNTER_BRANCH_MISSES:
+        return "branch misses";
+    }
+
+    return "none";
+}
@@ -0,0 +1,86 @@
+// fuzzing of the generator, floors are generated in batches and checked with floor_check
+// every batch goes to the next level id, so all levels are covered
+#define MAP_FUZZ_BATCH 8
+
+typedef struct MapFuzz
+{
+    int next_seed;
+    int level;
+
+    int checked;
+    int failed;
+
+    // failed floors per invariant (FLOOR_CHECK_* bit index)
+    int failures[FLOOR_CHECKS];
+
+    // first floor that failed, so it can be looked at (level is -1 while there is none)
+    int failed_seed;
+    int failed_level;
+    int failed_checks;
+} MapFuzz;
+
+Floor map_fuzz_floors[MAP_FUZZ_BATCH];
+
+void map_fuzz_reset(MapFuzz *fuzz, int first_seed)
+{
+    if (!fuzz)
+        return;
+
+    memset(fuzz, 0, sizeof(MapFuzz));
+    fuzz->next_seed = first_seed;
+    fuzz->failed_level = -1;
+}
+
+// generates and checks at least count floors, seeds continue where the last call stopped
+// returns amount of floors that failed
+int map_fuzz_run(MapFuzz *fuzz, int count)
+{
+    if (!fuzz)
+        return 0;
+
+    int old_level_id = level_id;
+    int failed = 0, done = 0;
+
+    while (done < count)
+    {
+        level_id = fuzz->level;
+        int i = 0;
+        for (i = 0; i < MAP_FUZZ_BATCH; i++)
+        {
+            map_generate_seeded(fuzz->next_seed + i);
+            map_floor_save(&map_fuzz_floors[i]);
+        }
+
+        for (i = 0; i < MAP_FUZZ_BATCH; i++)
+        {
+            int checks = floor_check(&map_fuzz_floors[i]);
+            fuzz->checked++;
+            if (!checks)
+                continue;
+
+            fuzz->failed++;
+            failed++;
+
+            int bit = 0;
+            for (bit = 0; bit < FLOOR_CHECKS; bit++)
+            {
+                if (checks & (1 << bit))
+                    fuzz->failures[bit]++;
+            }
+
+            if (fuzz->failed_level < 0)
+            {
+                fuzz->failed_seed = fuzz->next_seed + i;
+                fuzz->failed_level = fuzz->level;
+                fuzz->failed_checks = checks;
+            }
+        }
+
+        fuzz->next_seed += MAP_FUZZ_BATCH;
+        fuzz->level = (fuzz->level + 1) % (max_level_id + 1);
+        done += MAP_FUZZ_BATCH;
+    }
+
+    level_id = old_level_id;
+    return failed;
+}
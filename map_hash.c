@@ -0,0 +1,429 @@
+#define FLOOR_HASH_WORDS 4
+#define FLOOR_SYMMETRIES 8
+
+#define FLOOR_HASH_SET_MIN_CAPACITY 16
+
+// 128bit floor hash, use h[0] and h[1] when 64bits are enough
+typedef struct FloorHash
+{
+    unsigned long h[FLOOR_HASH_WORDS];
+} FloorHash;
+
+// open addressing set of floor hashes, all zero hash marks an empty slot
+typedef struct FloorHashSet
+{
+    int capacity;
+    int size;
+    int duplicates;
+    FloorHash *entries;
+} FloorHashSet;
+
+// how door directions change under each grid symmetry:
+// identity, rotate 90, rotate 180, rotate 270, flip x, flip y, transpose, anti-transpose
+int floor_symmetry_dir[32] = {
+    0, 1, 2, 3,
+    1, 2, 3, 0,
+    2, 3, 0, 1,
+    3, 0, 1, 2,
+    0, 3, 2, 1,
+    2, 1, 0, 3,
+    3, 2, 1, 0,
+    1, 0, 3, 2};
+
+// cell words of the floor being hashed, padded to the whole 4 word block
+unsigned long floor_hash_words[FLOOR_CELLS + FLOOR_HASH_WORDS];
+
+int is_floor_symmetry_valid(int symmetry)
+{
+    if (MAP_WIDTH == MAP_HEIGHT)
+        return true;
+
+    // rotating by 90 degrees or transposing changes non square map's size
+    return symmetry == 0 || symmetry == 2 || symmetry == 4 || symmetry == 5;
+}
+
+void floor_symmetry_cell(int symmetry, int x, int y, int *tx, int *ty)
+{
+    switch (symmetry)
+    {
+    case 0:
+        *tx = x;
+        *ty = y;
+        break;
+
+    case 1:
+        *tx = MAP_WIDTH - 1 - y;
+        *ty = x;
+        break;
+
+    case 2:
+        *tx = MAP_WIDTH - 1 - x;
+        *ty = MAP_HEIGHT - 1 - y;
+        break;
+
+    case 3:
+        *tx = y;
+        *ty = MAP_HEIGHT - 1 - x;
+        break;
+
+    case 4:
+        *tx = MAP_WIDTH - 1 - x;
+        *ty = y;
+        break;
+
+    case 5:
+        *tx = x;
+        *ty = MAP_HEIGHT - 1 - y;
+        break;
+
+    case 6:
+        *tx = y;
+        *ty = x;
+        break;
+
+    case 7:
+        *tx = MAP_WIDTH - 1 - y;
+        *ty = MAP_HEIGHT - 1 - x;
+        break;
+    }
+}
+
+int floor_symmetry_doors(int symmetry, int mask)
+{
+    int result = 0, n = 0;
+    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    {
+        int rotated = floor_symmetry_dir[symmetry * CARDINAL_DIRECTIONS + n];
+
+        if (mask & (1 << n))
+            result |= 1 << rotated;
+
+        if (mask & (1 << (n + DOOR_SECRET_SHIFT)))
+            result |= 1 << (rotated + DOOR_SECRET_SHIFT);
+    }
+
+    return result;
+}
+
+unsigned long hash_rotl(unsigned long x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+// murmur3 x86_128 over the given words (count has to be a multiple of 4)
+void hash_words_128(unsigned long *words, int count, FloorHash *hash)
+{
+    unsigned long c1 = 0x239B961B;
+    unsigned long c2 = 0xAB0E9789;
+    unsigned long c3 = 0x38B34AE5;
+    unsigned long c4 = 0xA1E38B93;
+
+    unsigned long h1 = 0x2545F491;
+    unsigned long h2 = 0x2545F491;
+    unsigned long h3 = 0x2545F491;
+    unsigned long h4 = 0x2545F491;
+
+    int i = 0;
+    for (i = 0; i < count; i += FLOOR_HASH_WORDS)
+    {
+        unsigned long k1 = words[i];
+        unsigned long k2 = words[i + 1];
+        unsigned long k3 = words[i + 2];
+        unsigned long k4 = words[i + 3];
+
+        k1 *= c1;
+        k1 = hash_rotl(k1, 15);
+        k1 *= c2;
+        h1 ^= k1;
+        h1 = hash_rotl(h1, 19);
+        h1 += h2;
+        h1 = h1 * 5 + 0x561CCD1B;
+
+        k2 *= c2;
+        k2 = hash_rotl(k2, 16);
+        k2 *= c3;
+        h2 ^= k2;
+        h2 = hash_rotl(h2, 17);
+        h2 += h3;
+        h2 = h2 * 5 + 0x0BCAA747;
+
+        k3 *= c3;
+        k3 = hash_rotl(k3, 17);
+        k3 *= c4;
+        h3 ^= k3;
+        h3 = hash_rotl(h3, 15);
+        h3 += h4;
+        h3 = h3 * 5 + 0x96CD1C35;
+
+        k4 *= c4;
+        k4 = hash_rotl(k4, 18);
+        k4 *= c1;
+        h4 ^= k4;
+        h4 = hash_rotl(h4, 13);
+        h4 += h1;
+        h4 = h4 * 5 + 0x32AC3B17;
+    }
+
+    h1 ^= count * 4;
+    h2 ^= count * 4;
+    h3 ^= count * 4;
+    h4 ^= count * 4;
+
+    h1 += h2 + h3 + h4;
+    h2 += h1;
+    h3 += h1;
+    h4 += h1;
+
+    h1 = hash_mix(h1);
+    h2 = hash_mix(h2);
+    h3 = hash_mix(h3);
+    h4 = hash_mix(h4);
+
+    h1 += h2 + h3 + h4;
+    h2 += h1;
+    h3 += h1;
+    h4 += h1;
+
+    hash->h[0] = h1;
+    hash->h[1] = h2;
+    hash->h[2] = h3;
+    hash->h[3] = h4;
+}
+
+// returns -1, 0 or 1 (compared as unsigned, word by word)
+int floor_hash_compare(FloorHash *a, FloorHash *b)
+{
+    int i = 0;
+    for (i = 0; i < FLOOR_HASH_WORDS; i++)
+    {
+        if (a->h[i] < b->h[i])
+            return -1;
+
+        if (a->h[i] > b->h[i])
+            return 1;
+    }
+
+    return 0;
+}
+
+void floor_hash_copy(FloorHash *dest, FloorHash *src)
+{
+    memcpy(dest, src, sizeof(FloorHash));
+}
+
+// hashes floor as seen through the given grid symmetry
+void floor_hash_symmetry(Floor *floor, int symmetry, FloorHash *hash)
+{
+    int count = FLOOR_CELLS;
+    while (count % FLOOR_HASH_WORDS)
+        count++;
+
+    memset(floor_hash_words, 0, count * sizeof(unsigned long));
+
+    int x = 0, y = 0;
+    for (y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (x = 0; x < MAP_WIDTH; x++)
+        {
+            int cell = floor_cell(x, y);
+            if (floor->type[cell] == ROOM_NONE)
+                continue;
+
+            int tx = 0, ty = 0;
+            floor_symmetry_cell(symmetry, x, y, &tx, &ty);
+
+            floor_hash_words[floor_cell(tx, ty)] = floor->type[cell] | (floor_symmetry_doors(symmetry, floor->doors[cell]) << 8) | (floor_symmetry_doors(symmetry, floor->links[cell]) << 16);
+        }
+    }
+
+    hash_words_128(floor_hash_words, count, hash);
+}
+
+// hashes room positions, door masks, links of bigger rooms and room types of the given floor
+// if canonical is true, the result is the same for all 8 rotations/reflections of the layout
+void floor_hash(Floor *floor, FloorHash *hash, int canonical)
+{
+    if (!floor || !hash)
+        return;
+
+    floor_hash_symmetry(floor, 0, hash);
+    if (!canonical)
+        return;
+
+    FloorHash temp_hash;
+
+    int i = 0;
+    for (i = 1; i < FLOOR_SYMMETRIES; i++)
+    {
+        if (!is_floor_symmetry_valid(i))
+            continue;
+
+        floor_hash_symmetry(floor, i, &temp_hash);
+        if (floor_hash_compare(&temp_hash, hash) < 0)
+            floor_hash_copy(hash, &temp_hash);
+    }
+}
+
+int is_floor_hash_empty(FloorHash *hash)
+{
+    return hash->h[0] == 0 && hash->h[1] == 0 && hash->h[2] == 0 && hash->h[3] == 0;
+}
+
+FloorHashSet *floor_hash_set_create(int capacity)
+{
+    FloorHashSet *set = sys_malloc(sizeof(FloorHashSet));
+    if (!set)
+        return NULL;
+
+    // capacity has to be power of two, so probing can use a mask
+    set->capacity = FLOOR_HASH_SET_MIN_CAPACITY;
+    while (set->capacity < capacity)
+        set->capacity *= 2;
+
+    set->size = 0;
+    set->duplicates = 0;
+    set->entries = sys_malloc(set->capacity * sizeof(FloorHash));
+    if (!set->entries)
+    {
+        sys_free(set);
+        return NULL;
+    }
+
+    memset(set->entries, 0, set->capacity * sizeof(FloorHash));
+    return set;
+}
+
+void floor_hash_set_destroy(FloorHashSet *set)
+{
+    if (!set)
+        return;
+
+    sys_free(set->entries);
+    sys_free(set);
+}
+
+void floor_hash_set_clear(FloorHashSet *set)
+{
+    if (!set)
+        return;
+
+    set->size = 0;
+    set->duplicates = 0;
+    memset(set->entries, 0, set->capacity * sizeof(FloorHash));
+}
+
+// returns slot that holds the given hash, or the empty slot where it should go
+FloorHash *floor_hash_set_slot(FloorHashSet *set, FloorHash *hash)
+{
+    int mask = set->capacity - 1;
+    int index = hash->h[0] & mask;
+    while (true)
+    {
+        FloorHash *slot = &set->entries[index];
+        if (is_floor_hash_empty(slot))
+            return slot;
+
+        if (floor_hash_compare(slot, hash) == 0)
+            return slot;
+
+        index = (index + 1) & mask;
+    }
+}
+
+// returns false if there was no memory for the bigger table, the old one is kept then
+int floor_hash_set_grow(FloorHashSet *set)
+{
+    FloorHash *entries = sys_malloc(set->capacity * 2 * sizeof(FloorHash));
+    if (!entries)
+        return false;
+
+    FloorHash *old_entries = set->entries;
+    int old_capacity = set->capacity;
+
+    set->capacity *= 2;
+    set->entries = entries;
+    memset(set->entries, 0, set->capacity * sizeof(FloorHash));
+
+    int i = 0;
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (is_floor_hash_empty(&old_entries[i]))
+            continue;
+
+        floor_hash_copy(floor_hash_set_slot(set, &old_entries[i]), &old_entries[i]);
+    }
+
+    sys_free(old_entries);
+    return true;
+}
+
+// all zero is reserved for empty slots, such a hash is kept as 1, 0, 0, 0 instead
+FloorHash *floor_hash_set_key(FloorHash *hash, FloorHash *key)
+{
+    if (!is_floor_hash_empty(hash))
+        return hash;
+
+    floor_hash_copy(key, hash);
+    key->h[0] = 1;
+    return key;
+}
+
+int floor_hash_set_contains(FloorHashSet *set, FloorHash *hash)
+{
+    if (!set || !hash)
+        return false;
+
+    FloorHash key;
+    return !is_floor_hash_empty(floor_hash_set_slot(set, floor_hash_set_key(hash, &key)));
+}
+
+// adds hash to the set, returns true if it wasn't there yet (otherwise counts a duplicate)
+int floor_hash_set_insert(FloorHashSet *set, FloorHash *hash)
+{
+    if (!set || !hash)
+        return false;
+
+    FloorHash key;
+    hash = floor_hash_set_key(hash, &key);
+
+    // keep load factor at 50% at most, if the table can't grow it's filled up further (one slot stays empty, so probing ends)
+    if ((set->size + 1) * 2 > set->capacity && !floor_hash_set_grow(set))
+    {
+        if (set->size + 1 >= set->capacity)
+            return false;
+    }
+
+    FloorHash *slot = floor_hash_set_slot(set, hash);
+    if (!is_floor_hash_empty(slot))
+    {
+        set->duplicates++;
+        return false;
+    }
+
+    floor_hash_copy(slot, hash);
+    set->size++;
+    return true;
+}
+
+// generates count floors (from seeds first_seed, first_seed + 1, ...) and adds their hashes to the set
+// returns amount of duplicates found in this batch, note that the current map is overwritten
+int floor_hash_batch(int first_seed, int count, FloorHashSet *set, int canonical)
+{
+    if (!set)
+        return 0;
+
+    Floor floor;
+    FloorHash hash;
+
+    int i = 0, duplicates = set->duplicates;
+    for (i = 0; i < count; i++)
+    {
+        map_generate_seeded(first_seed + i);
+        map_floor_save(&floor);
+
+        floor_hash(&floor, &hash, canonical);
+        floor_hash_set_insert(set, &hash);
+    }
+
+    return set->duplicates - duplicates;
+}
@@ -0,0 +1,190 @@
+// floor generated a bit at a time (map_generate_begin, then map_generate_step every frame until map_generate_done)
+// so it can run on the main thread without taking more than the given time out of any frame
+// map belongs to the job only while a step runs, in between the job's state is kept in it's context
+// and the map can be used for anything else (floors are the same as map_generate_level gives)
+#define MAP_JOB_ATTEMPT 0
+#define MAP_JOB_ROOMS 1
+#define MAP_JOB_END_ROOMS 2
+#define MAP_JOB_SPECIAL_ROOMS 3
+#define MAP_JOB_SECRETS 4
+#define MAP_JOB_SECRET_ROOMS 5
+#define MAP_JOB_DONE 6
+
+// job was limited to some attempts and none of them passed
+#define MAP_JOB_FAILED 7
+
+typedef struct MapJob
+{
+    int seed;
+    int level_id;
+    int state;
+    int attempts;
+
+    // job fails instead of starting this attempt (0 while there is no limit)
+    int attempts_end;
+
+    // room of the rooms queue that grows next
+    int queue_index;
+
+    // steps taken so far and the time they took (in microseconds)
+    int steps;
+    double time;
+
+    // gets the floor once it's done
+    Floor *floor;
+
+    MapContext context;
+} MapJob;
+
+// job only makes attempts first_attempt ... first_attempt + count - 1 of the floor and fails if none of them passes (count 0 for no limit)
+// floor is the same map_generate_level gives if the first attempt that passes is one of these
+void map_generate_begin_attempts(MapJob *job, int seed, int level, int first_attempt, int count, Floor *floor)
+{
+    if (!job)
+        return;
+
+    job->seed = seed;
+    job->level_id = level;
+    job->state = MAP_JOB_ATTEMPT;
+    job->attempts = first_attempt;
+    job->attempts_end = 0;
+    if (count > 0)
+        job->attempts_end = first_attempt + count;
+
+    job->queue_index = 0;
+    job->steps = 0;
+    job->time = 0;
+    job->floor = floor;
+}
+
+void map_generate_begin(MapJob *job, int seed, int level, Floor *floor)
+{
+    map_generate_begin_attempts(job, seed, level, 0, 0, floor);
+}
+
+// true once the job is over, the floor is only there if it didn't fail
+int map_generate_done(MapJob *job)
+{
+    if (!job)
+        return true;
+
+    return job->state == MAP_JOB_DONE || job->state == MAP_JOB_FAILED;
+}
+
+int map_generate_failed(MapJob *job)
+{
+    if (!job)
+        return true;
+
+    return job->state == MAP_JOB_FAILED;
+}
+
+// goes to the next state if the stage passed, otherwise starts a new attempt
+void map_job_next(MapJob *job, int passed, int state)
+{
+    if (passed)
+        job->state = state;
+    else
+        job->state = MAP_JOB_ATTEMPT;
+}
+
+// one piece of work: a whole stage, or a single room of the rooms queue while the layout grows
+void map_job_advance(MapJob *job)
+{
+    switch (job->state)
+    {
+    case MAP_JOB_ATTEMPT:
+        if (job->attempts_end > 0 && job->attempts >= job->attempts_end)
+        {
+            job->state = MAP_JOB_FAILED;
+            break;
+        }
+
+        map_seed = job->seed;
+        map_level_id = job->level_id;
+        map_random_seed(map_attempt_seed(job->seed, job->attempts));
+        job->attempts++;
+        map_attempts = job->attempts;
+
+        map_start_attempt();
+        map_add_start_room();
+        job->queue_index = 0;
+        job->state = MAP_JOB_ROOMS;
+        break;
+
+    case MAP_JOB_ROOMS:
+        if (job->queue_index < cell_list_size(&rooms_queue_list))
+        {
+            if (map_grow_room(job->queue_index))
+            {
+                job->queue_index++;
+                break;
+            }
+        }
+
+        map_job_next(job, map_check_layout(), MAP_JOB_END_ROOMS);
+        break;
+
+    case MAP_JOB_END_ROOMS:
+        map_job_next(job, map_collect_end_rooms(), MAP_JOB_SPECIAL_ROOMS);
+        break;
+
+    case MAP_JOB_SPECIAL_ROOMS:
+        map_job_next(job, map_place_special_rooms(), MAP_JOB_SECRETS);
+        break;
+
+    case MAP_JOB_SECRETS:
+        map_job_next(job, map_find_secrets(), MAP_JOB_SECRET_ROOMS);
+        break;
+
+    case MAP_JOB_SECRET_ROOMS:
+        map_job_next(job, map_place_secret_rooms(), MAP_JOB_DONE);
+        break;
+    }
+}
+
+// works on the floor until budget_us microseconds are used up, returns true once the job is done
+// budget is checked between pieces of work, so a step can go over it by one piece (and by saving the context)
+// every step does at least one piece of work
+int map_generate_step(MapJob *job, var budget_us)
+{
+    if (map_generate_done(job))
+        return true;
+
+    double start = map_clock_update();
+
+    int old_level_id = level_id;
+    level_id = job->level_id;
+
+    if (job->steps == 0)
+        map_floor_timing_begin();
+    else
+        map_context_restore(&job->context);
+
+    if (job->state == MAP_JOB_ROOMS)
+        map_stage_clock(MAP_STAGE_ROOMS);
+
+    do
+    {
+        map_job_advance(job);
+    } while (!map_generate_done(job) && map_clock_update() - start < budget_us);
+
+    map_stage_clock(MAP_STAGE_NONE);
+
+    if (job->state == MAP_JOB_DONE)
+    {
+        map_floor_timing_end();
+        map_floor_save(job->floor);
+    }
+    else if (job->state != MAP_JOB_FAILED)
+    {
+        map_context_save(&job->context);
+    }
+
+    level_id = old_level_id;
+
+    job->steps++;
+    job->time += map_clock_update() - start;
+
+    return map_generate_done(job);
+}
@@ -0,0 +1,206 @@
+// amount of ready floors kept for each level id
+#define MAP_POOL_CAPACITY 8
+
+// time the refill task may take out of every frame (in microseconds), floors are generated step by step
+#define MAP_POOL_REFILL_BUDGET 500
+
+// refill rate is measured over this many ticks (16 ticks = 1 second)
+#define MAP_POOL_RATE_TICKS 16
+
+// ring buffer of already validated floors for one level id
+typedef struct MapPool
+{
+    Floor floors[MAP_POOL_CAPACITY];
+    int head;
+    int count;
+
+    int taken;
+    int misses;
+    int refilled;
+} MapPool;
+
+MapPool *map_pools;
+int map_pools_count = 0;
+
+int map_pool_refill_running = false;
+var map_pool_refill_rate = 0;
+
+// floor being generated for the pool of map_pool_job_level (-1 while there is none)
+MapJob map_pool_job;
+Floor map_pool_job_floor;
+int map_pool_job_level = -1;
+
+void map_pools_create()
+{
+    map_pools_count = max_level_id + 1;
+    map_pools = sys_malloc(sizeof(MapPool) * map_pools_count);
+    if (!map_pools)
+    {
+        map_pools_count = 0;
+        return;
+    }
+
+    memset(map_pools, 0, sizeof(MapPool) * map_pools_count);
+}
+
+void map_pools_destroy()
+{
+    map_pool_refill_running = false;
+
+    sys_free(map_pools);
+    map_pools = NULL;
+    map_pools_count = 0;
+}
+
+// forgets all ready floors and the one that is being made (f.e. after generation settings changed)
+void map_pools_clear()
+{
+    map_pool_job_level = -1;
+
+    int i = 0;
+    for (i = 0; i < map_pools_count; i++)
+    {
+        map_pools[i].head = 0;
+        map_pools[i].count = 0;
+    }
+}
+
+MapPool *map_pool_get(int level)
+{
+    if (!map_pools)
+        return NULL;
+
+    int index = clamp(level, 0, map_pools_count - 1);
+    return &map_pools[index];
+}
+
+int is_map_pool_full(MapPool *pool)
+{
+    if (!pool)
+        return false;
+
+    return pool->count >= MAP_POOL_CAPACITY;
+}
+
+int map_pool_occupancy(int level)
+{
+    MapPool *pool = map_pool_get(level);
+    if (!pool)
+        return 0;
+
+    return pool->count;
+}
+
+void map_pool_put(MapPool *pool, Floor *floor)
+{
+    if (!pool || !floor)
+        return;
+
+    if (is_map_pool_full(pool))
+        return;
+
+    int index = (pool->head + pool->count) % MAP_POOL_CAPACITY;
+    memcpy(&pool->floors[index], floor, sizeof(Floor));
+    pool->count++;
+}
+
+// copies the oldest ready floor of the given level into floor
+// returns false if pool is empty, caller has to generate the floor itself then
+int map_pool_take(int level, Floor *floor)
+{
+    MapPool *pool = map_pool_get(level);
+    if (!pool || !floor)
+        return false;
+
+    if (pool->count <= 0)
+    {
+        pool->misses++;
+        return false;
+    }
+
+    memcpy(floor, &pool->floors[pool->head], sizeof(Floor));
+    pool->head = (pool->head + 1) % MAP_POOL_CAPACITY;
+    pool->count--;
+    pool->taken++;
+    return true;
+}
+
+// returns pool with the fewest ready floors (the level we are going to need soon wins ties), or NULL if all are full
+MapPool *map_pool_emptiest(int *level)
+{
+    MapPool *emptiest = NULL;
+
+    int i = 0;
+    for (i = 0; i < map_pools_count; i++)
+    {
+        int index = (level_id + i) % map_pools_count;
+        MapPool *pool = &map_pools[index];
+        if (is_map_pool_full(pool))
+            continue;
+
+        if (emptiest && emptiest->count <= pool->count)
+            continue;
+
+        emptiest = pool;
+        *level = index;
+    }
+
+    return emptiest;
+}
+
+// background task, keeps all the pools topped up
+// floors are generated with the map globals and stored encoded, so it doesn't touch the visible floor
+void map_pool_refill()
+{
+    if (map_pool_refill_running)
+        return;
+
+    map_pool_refill_running = true;
+    map_pool_job_level = -1;
+
+    int refilled = 0;
+    var rate_ticks = 0;
+
+    while (map_pool_refill_running)
+    {
+        double budget = MAP_POOL_REFILL_BUDGET;
+        while (budget > 0)
+        {
+            if (map_pool_job_level < 0)
+            {
+                int level = 0;
+                if (!map_pool_emptiest(&level))
+                    break;
+
+                map_generate_begin(&map_pool_job, map_random_floor_seed(), level, &map_pool_job_floor);
+                map_pool_job_level = level;
+            }
+
+            double time_before = map_pool_job.time;
+            int done = map_generate_step(&map_pool_job, budget);
+            budget -= map_pool_job.time - time_before;
+
+            if (!done)
+                continue;
+
+            MapPool *pool = map_pool_get(map_pool_job_level);
+            map_pool_job_level = -1;
+            if (!pool)
+                break;
+
+            map_pool_put(pool, &map_pool_job_floor);
+            pool->refilled++;
+            refilled++;
+        }
+
+        rate_ticks += time_frame;
+        if (rate_ticks >= MAP_POOL_RATE_TICKS)
+        {
+            map_pool_refill_rate = refilled * 16 / rate_ticks;
+            refilled = 0;
+            rate_ticks = 0;
+        }
+
+        wait(1);
+    }
+}
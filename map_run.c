@@ -0,0 +1,167 @@
+// all floors of a run (level ids 0 ... max_level_id), reproducible from the run seed alone
+// time a background run may take out of every frame (in microseconds), levels are generated step by step
+#define RUN_BUDGET 2000
+
+typedef struct Run
+{
+    int seed;
+    int levels;
+
+    // amount of levels that are generated already
+    int ready;
+
+    Floor *floors;
+
+    // job of level ready (only while job_running is true)
+    MapJob job;
+    int job_running;
+
+    // background task owns the run while it's running, run_destroy only asks it to stop then
+    int running;
+    int cancelled;
+} Run;
+
+// each level gets it's own seed, so levels can be generated in any order
+int run_level_seed(int seed, int level)
+{
+    return hash_mix(seed ^ hash_mix(level + 0x7F4A7C15));
+}
+
+Run *run_create(int seed)
+{
+    Run *run = sys_malloc(sizeof(Run));
+    if (!run)
+        return NULL;
+
+    run->seed = seed;
+    run->levels = max_level_id + 1;
+    run->ready = 0;
+    run->job_running = false;
+    run->running = false;
+    run->cancelled = false;
+    run->floors = sys_malloc(sizeof(Floor) * run->levels);
+    if (!run->floors)
+    {
+        sys_free(run);
+        return NULL;
+    }
+
+    memset(run->floors, 0, sizeof(Floor) * run->levels);
+    return run;
+}
+
+// a run that is still generated in the background is freed by it's task, once the task sees it's cancelled
+void run_destroy(Run *run)
+{
+    if (!run)
+        return;
+
+    if (run->running)
+    {
+        run->cancelled = true;
+        return;
+    }
+
+    sys_free(run->floors);
+    sys_free(run);
+}
+
+int is_run_ready(Run *run)
+{
+    if (!run)
+        return false;
+
+    return run->ready >= run->levels;
+}
+
+// returns floor of the given level, or NULL if it isn't generated yet
+Floor *run_floor(Run *run, int level)
+{
+    if (!run)
+        return NULL;
+
+    if (level < 0 || level >= run->levels)
+        return NULL;
+
+    Floor *floor = &run->floors[level];
+    if (floor->level_id != level || floor->seed != run_level_seed(run->seed, level))
+        return NULL;
+
+    return floor;
+}
+
+void run_generate_level(Run *run, int level)
+{
+    if (!run)
+        return;
+
+    map_generate_level(run_level_seed(run->seed, level), level);
+    map_floor_save(&run->floors[level]);
+    run->ready++;
+}
+
+// generates the whole run right away
+Run *generate_run(int seed)
+{
+    Run *run = run_create(seed);
+    if (!run)
+        return NULL;
+
+    int level = 0;
+    for (level = 0; level < run->levels; level++)
+        run_generate_level(run, level);
+
+    return run;
+}
+
+// works on the next levels until budget_us microseconds are used up, returns true once all levels are there
+// floors are the same as the ones generate_run() makes for this seed
+int run_step(Run *run, var budget_us)
+{
+    if (!run)
+        return true;
+
+    double start = map_clock_update();
+    while (run->ready < run->levels && map_clock_update() - start < budget_us)
+    {
+        int level = run->ready;
+        if (!run->job_running)
+        {
+            map_generate_begin(&run->job, run_level_seed(run->seed, level), level, &run->floors[level]);
+            run->job_running = true;
+        }
+
+        if (!map_generate_step(&run->job, budget_us - (map_clock_update() - start)))
+            continue;
+
+        run->job_running = false;
+        run->ready++;
+    }
+
+    return is_run_ready(run);
+}
+
+void run_task(Run *run)
+{
+    run->running = true;
+
+    while (!run->cancelled && !run_step(run, RUN_BUDGET))
+        wait(1);
+
+    run->running = false;
+
+    if (run->cancelled)
+        run_destroy(run);
+}
+
+// starts generating the whole run in the background and returns right away, check is_run_ready()
+// the run can be destroyed at any time, the background task lets go of it at it's next frame
+Run *generate_run_async(int seed)
+{
+    Run *run = run_create(seed);
+    if (!run)
+        return NULL;
+
+    run_task(run);
+    return run;
+}
@@ -0,0 +1,269 @@
+// seed search: finds seeds of a level whose floor has all the wanted properties (predicates)
+// every predicate belongs to the earliest job stage it can be checked after (MAP_JOB_ROOMS ... MAP_JOB_SECRET_ROOMS)
+// once one fails, no other predicate is checked on that attempt anymore (no floor saves, no searches through the floor)
+// the attempt still has to finish though: if it passes, it is the seed's floor and the seed is dropped,
+// if a later stage rejects it, the floor comes from another attempt and the seed is checked again on that one
+#define MAP_SEARCH_PREDICATES 8
+#define MAP_SEARCH_HITS 64
+
+// start room has a shop right next to it
+#define MAP_PREDICATE_SHOP_NEXT_TO_START 0
+
+// boss room is at least value doors away from the start room
+#define MAP_PREDICATE_BOSS_DEPTH 1
+
+// secret room is right next to an item room
+// (super secret rooms only ever border a single normal room, so they can't be next to one)
+#define MAP_PREDICATE_SECRET_NEXT_TO_ITEM 2
+
+// layout has at least value end rooms
+#define MAP_PREDICATE_END_ROOMS 3
+
+typedef struct MapPredicate
+{
+    int id;
+    int value;
+} MapPredicate;
+
+typedef struct MapSearch
+{
+    MapPredicate predicates[MAP_SEARCH_PREDICATES];
+    int predicates_count;
+
+    int level_id;
+    int next_seed;
+
+    int wanted_hits;
+    int hits[MAP_SEARCH_HITS];
+    int hits_count;
+
+    // seeds that were looked at, and the ones dropped because of a predicate of each job stage
+    int searched;
+    int dropped[MAP_JOB_DONE];
+
+    // attempts that failed a predicate but were rejected afterwards, so the seed was checked again
+    int retried;
+
+    // time spent searching (in microseconds)
+    double time;
+
+    MapJob job;
+    Floor floor;
+    int depth[FLOOR_CELLS];
+} MapSearch;
+
+MapSearch map_search;
+
+// earliest job stage the predicate can be checked after
+int map_predicate_stage(int id)
+{
+    switch (id)
+    {
+    case MAP_PREDICATE_SHOP_NEXT_TO_START:
+        return MAP_JOB_SPECIAL_ROOMS;
+
+    case MAP_PREDICATE_BOSS_DEPTH:
+        return MAP_JOB_SPECIAL_ROOMS;
+
+    case MAP_PREDICATE_SECRET_NEXT_TO_ITEM:
+        return MAP_JOB_SECRET_ROOMS;
+
+    case MAP_PREDICATE_END_ROOMS:
+        return MAP_JOB_END_ROOMS;
+    }
+
+    return MAP_JOB_SECRET_ROOMS;
+}
+
+// true if a room of the given type is right next to a room of the other type
+int is_floor_room_next_to(Floor *floor, int type, int other_type)
+{
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+    {
+        if (floor->type[cell] != type)
+            continue;
+
+        int n = 0;
+        for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+        {
+            int neighbour = floor_neighbour_cell(cell, n);
+            if (neighbour >= 0 && floor->type[neighbour] == other_type)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+int map_predicate_boss_depth(MapSearch *search, int depth)
+{
+    Floor *floor = &search->floor;
+
+    int boss_cell = floor_find_room(floor, ROOM_BOSS);
+    if (boss_cell < 0)
+        return false;
+
+    floor_depths(floor, floor_start_cell(), search->depth);
+    return search->depth[boss_cell] >= depth;
+}
+
+int map_predicate_check(MapSearch *search, MapPredicate *predicate)
+{
+    Floor *floor = &search->floor;
+
+    switch (predicate->id)
+    {
+    case MAP_PREDICATE_SHOP_NEXT_TO_START:
+        return is_floor_room_next_to(floor, ROOM_START, ROOM_SPECIAL);
+
+    case MAP_PREDICATE_BOSS_DEPTH:
+        return map_predicate_boss_depth(search, predicate->value);
+
+    case MAP_PREDICATE_SECRET_NEXT_TO_ITEM:
+        return is_floor_room_next_to(floor, ROOM_SECRET, ROOM_LOCKED);
+
+    case MAP_PREDICATE_END_ROOMS:
+        return floor->end_rooms >= predicate->value;
+    }
+
+    return false;
+}
+
+// level's seeds are searched from first_seed up, until wanted_hits seeds are found
+void map_search_begin(MapSearch *search, int level, int first_seed, int wanted_hits)
+{
+    if (!search)
+        return;
+
+    search->predicates_count = 0;
+    search->level_id = level;
+    search->next_seed = first_seed;
+    search->wanted_hits = clamp(wanted_hits, 1, MAP_SEARCH_HITS);
+    search->hits_count = 0;
+    search->searched = 0;
+    search->retried = 0;
+    search->time = 0;
+
+    memset(search->dropped, 0, sizeof(int) * MAP_JOB_DONE);
+}
+
+// returns false if there is no room for another predicate
+int map_search_add(MapSearch *search, int id, int value)
+{
+    if (!search)
+        return false;
+
+    if (search->predicates_count >= MAP_SEARCH_PREDICATES)
+        return false;
+
+    MapPredicate *predicate = &search->predicates[search->predicates_count];
+    predicate->id = id;
+    predicate->value = value;
+    search->predicates_count++;
+    return true;
+}
+
+// checks predicates of the stage that was just done, floor is only saved if one of them needs it
+int map_search_check_stage(MapSearch *search, int stage)
+{
+    int saved = false;
+
+    int i = 0;
+    for (i = 0; i < search->predicates_count; i++)
+    {
+        MapPredicate *predicate = &search->predicates[i];
+        if (map_predicate_stage(predicate->id) != stage)
+            continue;
+
+        if (!saved)
+        {
+            map_floor_save(&search->floor);
+            saved = true;
+        }
+
+        if (!map_predicate_check(search, predicate))
+            return false;
+    }
+
+    return true;
+}
+
+// generates the seed's floor stage by stage, returns true if all predicates hold on it
+int map_search_seed(MapSearch *search, int seed)
+{
+    MapJob *job = &search->job;
+    map_generate_begin(job, seed, search->level_id, &search->floor);
+
+    int old_level_id = level_id;
+    level_id = search->level_id;
+
+    // stage whose predicate failed on the running attempt (-1 while none did)
+    int failed_stage = -1;
+
+    while (!map_generate_done(job))
+    {
+        int state = job->state;
+        map_job_advance(job);
+
+        // attempt was rejected, the next one starts with a clean slate
+        if (job->state == MAP_JOB_ATTEMPT)
+        {
+            if (failed_stage >= 0)
+                search->retried++;
+
+            failed_stage = -1;
+            continue;
+        }
+
+        // stage is done once the job goes on to the next one
+        if (state == MAP_JOB_ATTEMPT || job->state != state + 1 || failed_stage >= 0)
+            continue;
+
+        if (!map_search_check_stage(search, state))
+            failed_stage = state;
+    }
+
+    level_id = old_level_id;
+
+    if (failed_stage < 0)
+        return true;
+
+    search->dropped[failed_stage]++;
+    return false;
+}
+
+// searches seeds until budget_us microseconds are used up, returns true once all wanted seeds are found
+// budget is checked between seeds, the map is used for the search meanwhile
+int map_search_step(MapSearch *search, var budget_us)
+{
+    if (!search)
+        return true;
+
+    double start = map_clock_update();
+
+    while (search->hits_count < search->wanted_hits && map_clock_update() - start < budget_us)
+    {
+        int seed = search->next_seed;
+        search->next_seed++;
+        search->searched++;
+
+        if (!map_search_seed(search, seed))
+            continue;
+
+        search->hits[search->hits_count] = seed;
+        search->hits_count++;
+    }
+
+    search->time += map_clock_update() - start;
+    return search->hits_count >= search->wanted_hits;
+}
+
+// seeds looked at per second so far
+double map_search_rate(MapSearch *search)
+{
+    if (!search || search->time <= 0)
+        return 0;
+
+    return search->searched * 1000000.0 / search->time;
+}
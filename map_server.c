@@ -0,0 +1,344 @@
+// generation server: other scripts ask for floors by (seed, level id) and get them back a few frames later
+// requests that came in since the last batch are taken together, the same floor asked for more than once is only generated once
+// finished floors stay in a ring of result slots and clients read them right there (no copy) until they release the request
+// Lite-C has no sockets or threads, so the server lives in the game's process and generates one floor at a time
+// within MAP_SERVER_BUDGET microseconds of every frame
+#define MAP_SERVER_REQUESTS 64
+#define MAP_SERVER_RESULTS 16
+#define MAP_SERVER_BATCH 8
+#define MAP_SERVER_BUDGET 2000
+
+// states of a request
+#define MAP_SERVER_FREE 0
+#define MAP_SERVER_QUEUED 1
+#define MAP_SERVER_BATCHED 2
+#define MAP_SERVER_DONE 3
+
+typedef struct MapServerRequest
+{
+    int state;
+    int seed;
+    int level_id;
+
+    // requests are batched in the order they came in
+    int ticket;
+
+    // result slot the request waits for (or got)
+    int result;
+
+    // time the request came in and how long it took to be served (in microseconds)
+    double submitted;
+    double latency;
+} MapServerRequest;
+
+typedef struct MapServerResult
+{
+    Floor floor;
+    int seed;
+    int level_id;
+
+    // requests that point at this slot, it can be used again once there are none and it's not in the batch anymore
+    int refs;
+    int pending;
+    int ready;
+} MapServerResult;
+
+typedef struct MapServer
+{
+    MapServerRequest requests[MAP_SERVER_REQUESTS];
+    MapServerResult results[MAP_SERVER_RESULTS];
+
+    // result slots of the current batch, generated in this order
+    int batch[MAP_SERVER_BATCH];
+    int batch_size;
+    int batch_index;
+
+    MapJob job;
+    int job_running;
+
+    int tickets;
+    int running;
+
+    int requested;
+    int rejected;
+    int coalesced;
+    int served;
+    int generated;
+    int batches;
+} MapServer;
+
+MapServer map_server;
+
+void map_server_reset()
+{
+    memset(&map_server, 0, sizeof(MapServer));
+}
+
+// returns handle of the request, or -1 if the queue is full (ask again next frame)
+int map_server_request(int seed, int level)
+{
+    MapServer *server = &map_server;
+
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_REQUESTS; i++)
+    {
+        MapServerRequest *request = &server->requests[i];
+        if (request->state != MAP_SERVER_FREE)
+            continue;
+
+        request->state = MAP_SERVER_QUEUED;
+        request->seed = seed;
+        request->level_id = level;
+        request->ticket = server->tickets;
+        request->result = -1;
+        request->submitted = map_clock_update();
+        request->latency = 0;
+
+        server->tickets++;
+        server->requested++;
+        return i;
+    }
+
+    server->rejected++;
+    return -1;
+}
+
+MapServerRequest *map_server_get(int handle)
+{
+    if (handle < 0 || handle >= MAP_SERVER_REQUESTS)
+        return NULL;
+
+    return &map_server.requests[handle];
+}
+
+// floor of the request once it's served, NULL until then
+// floor is owned by the server, it stays valid until the request is released
+Floor *map_server_floor(int handle)
+{
+    MapServerRequest *request = map_server_get(handle);
+    if (!request)
+        return NULL;
+
+    if (request->state != MAP_SERVER_DONE)
+        return NULL;
+
+    return &map_server.results[request->result].floor;
+}
+
+// microseconds from the request to it's floor (0 while it's not served)
+double map_server_latency(int handle)
+{
+    MapServerRequest *request = map_server_get(handle);
+    if (!request)
+        return 0;
+
+    return request->latency;
+}
+
+// gives the request (and it's floor) back, works for requests that aren't served yet too
+void map_server_release(int handle)
+{
+    MapServerRequest *request = map_server_get(handle);
+    if (!request)
+        return;
+
+    if (request->result >= 0)
+        map_server.results[request->result].refs--;
+
+    request->state = MAP_SERVER_FREE;
+    request->result = -1;
+}
+
+void map_server_serve(MapServer *server, MapServerRequest *request)
+{
+    request->state = MAP_SERVER_DONE;
+    request->latency = map_clock_update() - request->submitted;
+    server->served++;
+}
+
+void map_server_attach(MapServer *server, MapServerRequest *request, int result)
+{
+    MapServerResult *slot = &server->results[result];
+
+    request->result = result;
+    slot->refs++;
+
+    if (slot->ready)
+        map_server_serve(server, request);
+    else
+        request->state = MAP_SERVER_BATCHED;
+}
+
+// oldest queued request, or -1 if there is none
+int map_server_oldest(MapServer *server)
+{
+    int oldest = -1;
+
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_REQUESTS; i++)
+    {
+        MapServerRequest *request = &server->requests[i];
+        if (request->state != MAP_SERVER_QUEUED)
+            continue;
+
+        if (oldest >= 0 && server->requests[oldest].ticket <= request->ticket)
+            continue;
+
+        oldest = i;
+    }
+
+    return oldest;
+}
+
+// slot that already has (or is going to have) the floor, or -1
+int map_server_find_result(MapServer *server, int seed, int level)
+{
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_RESULTS; i++)
+    {
+        MapServerResult *slot = &server->results[i];
+        if (slot->refs <= 0 && !slot->pending)
+            continue;
+
+        if (slot->seed == seed && slot->level_id == level)
+            return i;
+    }
+
+    return -1;
+}
+
+int map_server_free_result(MapServer *server)
+{
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_RESULTS; i++)
+    {
+        MapServerResult *slot = &server->results[i];
+        if (slot->refs <= 0 && !slot->pending)
+            return i;
+    }
+
+    return -1;
+}
+
+// takes queued requests (oldest first) into the next batch
+// requests for a floor that is already there or in the batch don't add anything to it
+void map_server_batch(MapServer *server)
+{
+    server->batch_size = 0;
+    server->batch_index = 0;
+
+    while (server->batch_size < MAP_SERVER_BATCH)
+    {
+        int handle = map_server_oldest(server);
+        if (handle < 0)
+            break;
+
+        MapServerRequest *request = &server->requests[handle];
+
+        int result = map_server_find_result(server, request->seed, request->level_id);
+        if (result >= 0)
+        {
+            map_server_attach(server, request, result);
+            server->coalesced++;
+            continue;
+        }
+
+        // all slots are still held by clients, rest waits for the next batch
+        result = map_server_free_result(server);
+        if (result < 0)
+            break;
+
+        MapServerResult *slot = &server->results[result];
+        slot->seed = request->seed;
+        slot->level_id = request->level_id;
+        slot->refs = 0;
+        slot->pending = true;
+        slot->ready = false;
+
+        server->batch[server->batch_size] = result;
+        server->batch_size++;
+
+        map_server_attach(server, request, result);
+    }
+
+    if (server->batch_size > 0)
+        server->batches++;
+}
+
+void map_server_finish(MapServer *server, int result)
+{
+    MapServerResult *slot = &server->results[result];
+    slot->pending = false;
+    slot->ready = true;
+
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_REQUESTS; i++)
+    {
+        MapServerRequest *request = &server->requests[i];
+        if (request->state == MAP_SERVER_BATCHED && request->result == result)
+            map_server_serve(server, request);
+    }
+}
+
+// works on the batch until budget_us microseconds are used up, starts a new batch once the old one is done
+void map_server_update(var budget_us)
+{
+    MapServer *server = &map_server;
+
+    double start = map_clock_update();
+    while (map_clock_update() - start < budget_us)
+    {
+        if (server->batch_index >= server->batch_size)
+        {
+            map_server_batch(server);
+            if (server->batch_size <= 0)
+                break;
+        }
+
+        int result = server->batch[server->batch_index];
+        MapServerResult *slot = &server->results[result];
+
+        // everyone who wanted it has released it already
+        if (!server->job_running && slot->refs <= 0)
+        {
+            slot->pending = false;
+            server->batch_index++;
+            continue;
+        }
+
+        if (!server->job_running)
+        {
+            map_generate_begin(&server->job, slot->seed, slot->level_id, &slot->floor);
+            server->job_running = true;
+        }
+
+        if (!map_generate_step(&server->job, budget_us - (map_clock_update() - start)))
+            continue;
+
+        server->job_running = false;
+        server->batch_index++;
+        server->generated++;
+
+        map_server_finish(server, result);
+    }
+}
+
+// background task, serves requests until map_server_stop is called
+void map_server_run()
+{
+    if (map_server.running)
+        return;
+
+    map_server.running = true;
+
+    while (map_server.running)
+    {
+        map_server_update(MAP_SERVER_BUDGET);
+        wait(1);
+    }
+}
+
+void map_server_stop()
+{
+    map_server.running = false;
+}
@@ -0,0 +1,138 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+
+// load generator for map_server.c, MAP_SERVER_LOAD_CLIENTS clients keep one request each in flight
+// every client asks for the next floor as soon as it got the last one, seeds come from a small range
+// so clients ask for the same floors now and then (like players of the same seed)
+// writes requests/sec and latency percentiles into map_server_load.txt
+#define MAP_SERVER_LOAD_CLIENTS 16
+#define MAP_SERVER_LOAD_SEEDS 256
+#define MAP_SERVER_LOAD_FRAMES 960
+
+// latency histogram, bucket b holds requests that took b ... b+1 bucket widths (last bucket takes everything slower)
+#define MAP_SERVER_LOAD_BUCKETS 1024
+#define MAP_SERVER_LOAD_BUCKET_WIDTH 100
+
+int map_server_load_handle[MAP_SERVER_LOAD_CLIENTS];
+int map_server_load_latency[MAP_SERVER_LOAD_BUCKETS];
+
+int map_server_load_served = 0;
+double map_server_load_latency_max = 0;
+
+void map_server_load_ask(int client)
+{
+    int seed = (int)random(MAP_SERVER_LOAD_SEEDS);
+    int level = (int)random(max_level_id + 1);
+    map_server_load_handle[client] = map_server_request(seed, level);
+}
+
+// polls every client, takes finished floors and asks for new ones
+void map_server_load_poll()
+{
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_LOAD_CLIENTS; i++)
+    {
+        int handle = map_server_load_handle[i];
+        if (handle < 0)
+        {
+            map_server_load_ask(i);
+            continue;
+        }
+
+        Floor *floor = map_server_floor(handle);
+        if (!floor)
+            continue;
+
+        double latency = map_server_latency(handle);
+        int bucket = latency / MAP_SERVER_LOAD_BUCKET_WIDTH;
+        if (bucket >= MAP_SERVER_LOAD_BUCKETS)
+            bucket = MAP_SERVER_LOAD_BUCKETS - 1;
+
+        map_server_load_latency[bucket]++;
+        map_server_load_served++;
+
+        if (latency > map_server_load_latency_max)
+            map_server_load_latency_max = latency;
+
+        map_server_release(handle);
+        map_server_load_ask(i);
+    }
+}
+
+// latency (upper end of it's bucket) that the given percent of requests stayed under
+double map_server_load_percentile(int percent)
+{
+    int wanted = map_server_load_served * percent / 100;
+    int count = 0;
+
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_LOAD_BUCKETS; i++)
+    {
+        count += map_server_load_latency[i];
+        if (count >= wanted)
+            return (i + 1) * MAP_SERVER_LOAD_BUCKET_WIDTH;
+    }
+
+    return map_server_load_latency_max;
+}
+
+void map_server_load_write(double seconds)
+{
+    var file = file_open_write("map_server_load.txt");
+    if (!file)
+        return;
+
+    MapServer *server = &map_server;
+
+    file_str_write(file, str_printf(NULL, "clients=%d;\nseeds=%d;\nframes=%d;\nbudget=%dus;\n", (long)MAP_SERVER_LOAD_CLIENTS, (long)MAP_SERVER_LOAD_SEEDS,
+                                     (long)MAP_SERVER_LOAD_FRAMES, (long)MAP_SERVER_BUDGET));
+    file_str_write(file, str_printf(NULL, "served=%d;\nrequests/sec=%.1f;\n", (long)map_server_load_served, (double)(map_server_load_served / seconds)));
+    file_str_write(file, str_printf(NULL, "generated=%d;\ncoalesced=%d;\nbatches=%d;\nrejected=%d;\n", (long)server->generated, (long)server->coalesced,
+                                     (long)server->batches, (long)server->rejected));
+    file_str_write(file, str_printf(NULL, "latency p50=%dus;\nlatency p99=%dus;\nlatency max=%dus;\n", (long)map_server_load_percentile(50),
+                                     (long)map_server_load_percentile(99), (long)map_server_load_latency_max));
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+    map_server_reset();
+
+    int i = 0;
+    for (i = 0; i < MAP_SERVER_LOAD_CLIENTS; i++)
+        map_server_load_handle[i] = -1;
+
+    double start = map_clock_update();
+
+    int frame = 0;
+    for (frame = 0; frame < MAP_SERVER_LOAD_FRAMES; frame++)
+    {
+        map_server_load_poll();
+        map_server_update(MAP_SERVER_BUDGET);
+
+        draw_text(str_printf(NULL, "frame %d/%d;\nserved=%d;", (long)frame, (long)MAP_SERVER_LOAD_FRAMES, (long)map_server_load_served), 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    map_server_load_write((map_clock_update() - start) / 1000000);
+
+    while (!key_esc)
+    {
+        draw_text("done, map_server_load.txt is written", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
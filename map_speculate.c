@@ -0,0 +1,124 @@
+// speculative attempts: count attempts of one floor run side by side (from the same seed, attempt i is the one map_generate_level makes i-th)
+// and the lowest attempt that passes wins, so the floor is the same map_generate_level gives for the seed
+// once an attempt passes, all attempts after it are cancelled (attempts before it still have to finish, one of them could pass too)
+// every attempt is a job with it's own context, so they don't share any state
+// Lite-C runs all scripts on one thread though, so here the attempts take turns of MAP_SPECULATE_SLICE microseconds each
+// and a floor is never made faster than map_generate_level makes it (map_speculate_load.c measures by how much it's slower)
+#define MAP_SPECULATE_MAX 8
+#define MAP_SPECULATE_SLICE 20
+
+typedef struct MapSpeculation
+{
+    // attempts that run side by side (1 ... MAP_SPECULATE_MAX)
+    int count;
+
+    MapJob *jobs;
+    Floor *floors;
+
+    // attempts started and attempts cancelled before they were done, over all calls
+    int started;
+    int cancelled;
+} MapSpeculation;
+
+MapSpeculation *map_speculation_create(int count)
+{
+    MapSpeculation *speculation = sys_malloc(sizeof(MapSpeculation));
+    if (!speculation)
+        return NULL;
+
+    speculation->count = clamp(count, 1, MAP_SPECULATE_MAX);
+    speculation->started = 0;
+    speculation->cancelled = 0;
+
+    speculation->jobs = sys_malloc(sizeof(MapJob) * speculation->count);
+    speculation->floors = sys_malloc(sizeof(Floor) * speculation->count);
+    if (!speculation->jobs || !speculation->floors)
+    {
+        if (speculation->jobs)
+            sys_free(speculation->jobs);
+
+        if (speculation->floors)
+            sys_free(speculation->floors);
+
+        sys_free(speculation);
+        return NULL;
+    }
+
+    return speculation;
+}
+
+void map_speculation_destroy(MapSpeculation *speculation)
+{
+    if (!speculation)
+        return;
+
+    sys_free(speculation->jobs);
+    sys_free(speculation->floors);
+    sys_free(speculation);
+}
+
+// runs attempts first_attempt ... first_attempt + count - 1 of the floor side by side
+// returns index of the lowest one that passed (it's floor is in floors[index]) or -1 if none did
+int map_speculate_round(MapSpeculation *speculation, int seed, int level, int first_attempt)
+{
+    int count = speculation->count;
+
+    int i = 0;
+    for (i = 0; i < count; i++)
+        map_generate_begin_attempts(&speculation->jobs[i], seed, level, first_attempt + i, 1, &speculation->floors[i]);
+
+    speculation->started += count;
+
+    int winner = -1;
+    int running = (1 << count) - 1;
+
+    while (running)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (!(running & (1 << i)))
+                continue;
+
+            // cooperative cancel, an attempt only stops between it's turns
+            if (winner >= 0 && i > winner)
+            {
+                running &= ~(1 << i);
+                speculation->cancelled++;
+                continue;
+            }
+
+            if (!map_generate_step(&speculation->jobs[i], MAP_SPECULATE_SLICE))
+                continue;
+
+            running &= ~(1 << i);
+            if (map_generate_failed(&speculation->jobs[i]))
+                continue;
+
+            if (winner < 0 || i < winner)
+                winner = i;
+        }
+    }
+
+    return winner;
+}
+
+// generates floor of the given level from the seed, speculation's count attempts at a time
+// floor is the same map_generate_level gives, map globals are left with whatever attempt ran last
+void map_generate_speculative(MapSpeculation *speculation, int seed, int level, Floor *floor)
+{
+    if (!speculation || !floor)
+        return;
+
+    int first_attempt = 0;
+    while (true)
+    {
+        int winner = map_speculate_round(speculation, seed, level, first_attempt);
+        if (winner >= 0)
+        {
+            memcpy(floor, &speculation->floors[winner], sizeof(Floor));
+            return;
+        }
+
+        first_attempt += speculation->count;
+    }
+}
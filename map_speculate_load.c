@@ -0,0 +1,187 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+#include "map_speculate.c"
+
+// time to floor of speculative attempts (map_speculate.c) next to plain map_generate_level
+// the same seeds of every level are generated once sequentially and once with every attempt count of map_speculate_load_counts
+// speculative floors have to be the same as the sequential ones, floors that aren't are counted as mismatches
+// writes latency percentiles of every mode into map_speculate_load.txt
+#define MAP_SPECULATE_LOAD_SEEDS 1024
+#define MAP_SPECULATE_LOAD_FIRST_SEED 1
+#define MAP_SPECULATE_LOAD_FLOORS (MAP_SPECULATE_LOAD_SEEDS * MAP_LEVELS)
+
+// attempts side by side of every mode (0 is plain map_generate_level)
+#define MAP_SPECULATE_LOAD_MODES 5
+int map_speculate_load_counts[MAP_SPECULATE_LOAD_MODES] = {0, 1, 2, 4, 8};
+
+// time to floor of every floor of the mode being measured (in microseconds)
+double map_speculate_load_latency[MAP_SPECULATE_LOAD_FLOORS];
+
+double map_speculate_load_p50[MAP_SPECULATE_LOAD_MODES];
+double map_speculate_load_p99[MAP_SPECULATE_LOAD_MODES];
+double map_speculate_load_max[MAP_SPECULATE_LOAD_MODES];
+int map_speculate_load_cancelled[MAP_SPECULATE_LOAD_MODES];
+int map_speculate_load_mismatches[MAP_SPECULATE_LOAD_MODES];
+
+// sequential floors, speculative ones are compared with these
+FloorHash map_speculate_load_hash[MAP_SPECULATE_LOAD_FLOORS];
+
+Floor map_speculate_load_floor;
+
+// sorts the latencies (insertion sort, they are measured once per mode only)
+void map_speculate_load_sort()
+{
+    int i = 0;
+    for (i = 1; i < MAP_SPECULATE_LOAD_FLOORS; i++)
+    {
+        double value = map_speculate_load_latency[i];
+
+        int j = i - 1;
+        while (j >= 0)
+        {
+            if (map_speculate_load_latency[j] <= value)
+                break;
+
+            map_speculate_load_latency[j + 1] = map_speculate_load_latency[j];
+            j--;
+        }
+
+        map_speculate_load_latency[j + 1] = value;
+    }
+}
+
+// latency that the given percent of floors stayed under (latencies have to be sorted)
+double map_speculate_load_percentile(int percent)
+{
+    int index = MAP_SPECULATE_LOAD_FLOORS * percent / 100;
+    if (index >= MAP_SPECULATE_LOAD_FLOORS)
+        index = MAP_SPECULATE_LOAD_FLOORS - 1;
+
+    return map_speculate_load_latency[index];
+}
+
+// generates all floors in the given mode, returns false if speculation couldn't be allocated
+int map_speculate_load_measure(int mode)
+{
+    int count = map_speculate_load_counts[mode];
+
+    MapSpeculation *speculation = NULL;
+    if (count > 0)
+    {
+        speculation = map_speculation_create(count);
+        if (!speculation)
+            return false;
+    }
+
+    int level = 0, seed = 0, index = 0;
+    for (level = 0; level < MAP_LEVELS; level++)
+    {
+        for (seed = 0; seed < MAP_SPECULATE_LOAD_SEEDS; seed++)
+        {
+            double start = map_clock_update();
+
+            if (speculation)
+            {
+                map_generate_speculative(speculation, MAP_SPECULATE_LOAD_FIRST_SEED + seed, level, &map_speculate_load_floor);
+            }
+            else
+            {
+                map_generate_level(MAP_SPECULATE_LOAD_FIRST_SEED + seed, level);
+                map_floor_save(&map_speculate_load_floor);
+            }
+
+            map_speculate_load_latency[index] = map_clock_update() - start;
+
+            FloorHash hash;
+            floor_hash(&map_speculate_load_floor, &hash, false);
+            if (speculation)
+            {
+                if (floor_hash_compare(&hash, &map_speculate_load_hash[index]) != 0)
+                    map_speculate_load_mismatches[mode]++;
+            }
+            else
+            {
+                memcpy(&map_speculate_load_hash[index], &hash, sizeof(FloorHash));
+            }
+
+            index++;
+        }
+    }
+
+    map_speculate_load_sort();
+    map_speculate_load_p50[mode] = map_speculate_load_percentile(50);
+    map_speculate_load_p99[mode] = map_speculate_load_percentile(99);
+    map_speculate_load_max[mode] = map_speculate_load_latency[MAP_SPECULATE_LOAD_FLOORS - 1];
+
+    if (speculation)
+    {
+        map_speculate_load_cancelled[mode] = speculation->cancelled;
+        map_speculation_destroy(speculation);
+    }
+
+    return true;
+}
+
+void map_speculate_load_write()
+{
+    var file = file_open_write("map_speculate_load.txt");
+    if (!file)
+        return;
+
+    file_str_write(file, str_printf(NULL, "floors=%d;\nslice=%dus;\n", (long)MAP_SPECULATE_LOAD_FLOORS, (long)MAP_SPECULATE_SLICE));
+
+    int mode = 0;
+    for (mode = 0; mode < MAP_SPECULATE_LOAD_MODES; mode++)
+    {
+        int count = map_speculate_load_counts[mode];
+        if (count > 0)
+            file_str_write(file, str_printf(NULL, "attempts side by side=%d; ", (long)count));
+        else
+            file_str_write(file, "sequential; ");
+
+        file_str_write(file, str_printf(NULL, "p50=%dus; p99=%dus; max=%dus; cancelled=%d; mismatches=%d;\n", (long)map_speculate_load_p50[mode],
+                                         (long)map_speculate_load_p99[mode], (long)map_speculate_load_max[mode], (long)map_speculate_load_cancelled[mode],
+                                         (long)map_speculate_load_mismatches[mode]));
+    }
+
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+
+    int mode = 0;
+    for (mode = 0; mode < MAP_SPECULATE_LOAD_MODES; mode++)
+    {
+        map_speculate_load_cancelled[mode] = 0;
+        map_speculate_load_mismatches[mode] = 0;
+
+        draw_text(str_printf(NULL, "mode %d/%d;", (long)mode, (long)MAP_SPECULATE_LOAD_MODES), 10, 10, COLOR_RED);
+        wait(1);
+
+        if (!map_speculate_load_measure(mode))
+            break;
+    }
+
+    map_speculate_load_write();
+
+    while (!key_esc)
+    {
+        draw_text("done, map_speculate_load.txt is written", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
@@ -0,0 +1,421 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+
+// searches generation parameters (see map_rooms_base in map.c) for ones that need fewer attempts per floor
+// every configuration of the grid below generates the same seeds on every level
+// and it's layout statistics are compared with the ones of the default parameters (1 - total variation distance of the histograms)
+// configurations that no other one beats on both attempts per floor and similarity are the pareto front, all of it goes into map_tuner.txt
+// the whole grid is 3^6 * 2 = 1458 configurations, a full run takes one to two minutes
+#define MAP_TUNER_FLOORS_PER_LEVEL 1000
+#define MAP_TUNER_FIRST_SEED 1
+
+// some configurations can't make a floor at all (f.e. too few rooms for all end rooms)
+// once a floor gives up after this many attempts the configuration isn't measured any further and is left out of the front
+#define MAP_TUNER_MAX_ATTEMPTS 1000
+
+// time one floor may take (in microseconds), it's never used up, so every floor is made in a single step
+#define MAP_TUNER_BUDGET 500000
+
+// levels 0 ... max_level_id
+#define MAP_TUNER_LEVELS MAP_LEVELS
+
+// histograms have one bucket per value, bigger values go into the last bucket
+#define MAP_TUNER_BUCKETS 32
+
+// layout statistics compared between configurations
+#define MAP_TUNER_ROOMS 0
+#define MAP_TUNER_END_ROOMS 1
+#define MAP_TUNER_BOSS_DEPTH 2
+#define MAP_TUNER_SECRETS 3
+#define MAP_TUNER_ITEM_ROOMS 4
+#define MAP_TUNER_STATS 5
+
+#define MAP_TUNER_HISTOGRAM_SIZE (MAP_TUNER_STATS * MAP_TUNER_LEVELS * MAP_TUNER_BUCKETS)
+
+// parameters that are searched, with up to MAP_TUNER_VALUES values each (-1 for unused ones)
+#define MAP_TUNER_GROW_SKIP 0
+#define MAP_TUNER_ROOMS_BASE 1
+#define MAP_TUNER_ROOMS_SPREAD 2
+#define MAP_TUNER_ROOMS_PER_LEVEL 3
+#define MAP_TUNER_SECRETS_SPREAD 4
+#define MAP_TUNER_ITEM_ROOMS_SPREAD 5
+#define MAP_TUNER_REVIVE 6
+#define MAP_TUNER_PARAMS 7
+
+#define MAP_TUNER_VALUES 3
+
+int map_tuner_values[MAP_TUNER_PARAMS * MAP_TUNER_VALUES] = {
+    2, 3, 4,    // map_grow_skip
+    4, 5, 6,    // map_rooms_base
+    1, 2, 3,    // map_rooms_spread
+    22, 26, 30, // map_rooms_per_level
+    1, 2, 3,    // map_secrets_spread
+    1, 2, 3,    // map_item_rooms_spread
+    0, 1, -1    // map_revive
+};
+
+#define MAP_TUNER_MAX_CONFIGS 1458
+
+typedef struct MapTunerConfig
+{
+    int values[MAP_TUNER_PARAMS];
+
+    double attempts_per_floor;
+    double similarity;
+    int failed;
+    int pareto;
+} MapTunerConfig;
+
+MapTunerConfig map_tuner_configs[MAP_TUNER_MAX_CONFIGS];
+int map_tuner_configs_count = 0;
+
+// statistics of the default parameters and of the configuration that is being measured
+int map_tuner_reference[MAP_TUNER_HISTOGRAM_SIZE];
+int map_tuner_histogram[MAP_TUNER_HISTOGRAM_SIZE];
+
+int map_tuner_default[MAP_TUNER_PARAMS];
+
+MapJob map_tuner_job;
+Floor map_tuner_floor;
+int map_tuner_depth[FLOOR_CELLS];
+
+// true once a floor of the last measured level gave up
+int map_tuner_failed = false;
+
+int map_tuner_param_get(int param)
+{
+    switch (param)
+    {
+    case MAP_TUNER_GROW_SKIP:
+        return map_grow_skip;
+
+    case MAP_TUNER_ROOMS_BASE:
+        return map_rooms_base;
+
+    case MAP_TUNER_ROOMS_SPREAD:
+        return map_rooms_spread;
+
+    case MAP_TUNER_ROOMS_PER_LEVEL:
+        return map_rooms_per_level;
+
+    case MAP_TUNER_SECRETS_SPREAD:
+        return map_secrets_spread;
+
+    case MAP_TUNER_ITEM_ROOMS_SPREAD:
+        return map_item_rooms_spread;
+
+    case MAP_TUNER_REVIVE:
+        return map_revive;
+    }
+
+    return 0;
+}
+
+void map_tuner_param_set(int param, int value)
+{
+    switch (param)
+    {
+    case MAP_TUNER_GROW_SKIP:
+        map_grow_skip = value;
+        break;
+
+    case MAP_TUNER_ROOMS_BASE:
+        map_rooms_base = value;
+        break;
+
+    case MAP_TUNER_ROOMS_SPREAD:
+        map_rooms_spread = value;
+        break;
+
+    case MAP_TUNER_ROOMS_PER_LEVEL:
+        map_rooms_per_level = value;
+        break;
+
+    case MAP_TUNER_SECRETS_SPREAD:
+        map_secrets_spread = value;
+        break;
+
+    case MAP_TUNER_ITEM_ROOMS_SPREAD:
+        map_item_rooms_spread = value;
+        break;
+
+    case MAP_TUNER_REVIVE:
+        map_revive = value;
+        break;
+    }
+}
+
+void map_tuner_apply(int *values)
+{
+    int i = 0;
+    for (i = 0; i < MAP_TUNER_PARAMS; i++)
+        map_tuner_param_set(i, values[i]);
+}
+
+// fills map_tuner_configs with every combination of the values
+void map_tuner_create_configs()
+{
+    int counts[MAP_TUNER_PARAMS];
+    int total = 1;
+
+    int param = 0, value = 0;
+    for (param = 0; param < MAP_TUNER_PARAMS; param++)
+    {
+        counts[param] = 0;
+        for (value = 0; value < MAP_TUNER_VALUES; value++)
+        {
+            if (map_tuner_values[param * MAP_TUNER_VALUES + value] >= 0)
+                counts[param]++;
+        }
+
+        total *= counts[param];
+    }
+
+    map_tuner_configs_count = minv(total, MAP_TUNER_MAX_CONFIGS);
+
+    int i = 0;
+    for (i = 0; i < map_tuner_configs_count; i++)
+    {
+        MapTunerConfig *config = &map_tuner_configs[i];
+
+        int rest = i;
+        for (param = 0; param < MAP_TUNER_PARAMS; param++)
+        {
+            config->values[param] = map_tuner_values[param * MAP_TUNER_VALUES + (rest % counts[param])];
+            rest = rest / counts[param];
+        }
+
+        config->attempts_per_floor = 0;
+        config->similarity = 0;
+        config->failed = 0;
+        config->pareto = false;
+    }
+}
+
+void map_tuner_histogram_add(int *histogram, int stat, int level, int value)
+{
+    int bucket = clamp(value, 0, MAP_TUNER_BUCKETS - 1);
+    histogram[(stat * MAP_TUNER_LEVELS + level) * MAP_TUNER_BUCKETS + bucket]++;
+}
+
+void map_tuner_add_floor(int *histogram, Floor *floor)
+{
+    int level = clamp(floor->level_id, 0, MAP_TUNER_LEVELS - 1);
+
+    map_tuner_histogram_add(histogram, MAP_TUNER_ROOMS, level, floor->rooms);
+    map_tuner_histogram_add(histogram, MAP_TUNER_END_ROOMS, level, floor->end_rooms);
+    map_tuner_histogram_add(histogram, MAP_TUNER_SECRETS, level, floor->secrets);
+    map_tuner_histogram_add(histogram, MAP_TUNER_ITEM_ROOMS, level, floor->item_rooms);
+
+    // unreachable boss goes into bucket 0
+    int depth = 0;
+    int boss_cell = floor_find_room(floor, ROOM_BOSS);
+    floor_depths(floor, floor_start_cell(), map_tuner_depth);
+    if (boss_cell >= 0 && map_tuner_depth[boss_cell] >= 0)
+        depth = map_tuner_depth[boss_cell];
+
+    map_tuner_histogram_add(histogram, MAP_TUNER_BOSS_DEPTH, level, depth);
+}
+
+// generates all floors of one level with the current parameters, returns attempts they took
+int map_tuner_measure_level(int *histogram, int level)
+{
+    int attempts = 0;
+    map_tuner_failed = false;
+
+    int i = 0;
+    for (i = 0; i < MAP_TUNER_FLOORS_PER_LEVEL; i++)
+    {
+        MapJob *job = &map_tuner_job;
+        map_generate_begin_attempts(job, MAP_TUNER_FIRST_SEED + i, level, 0, MAP_TUNER_MAX_ATTEMPTS, &map_tuner_floor);
+
+        while (!map_generate_step(job, MAP_TUNER_BUDGET))
+            continue;
+
+        if (map_generate_failed(job))
+        {
+            map_tuner_failed = true;
+            break;
+        }
+
+        attempts += map_tuner_floor.attempts;
+        map_tuner_add_floor(histogram, &map_tuner_floor);
+    }
+
+    return attempts;
+}
+
+// 1 minus total variation distance, averaged over all statistics and levels (1 for the same distributions)
+double map_tuner_similarity(int *histogram)
+{
+    double distance = 0;
+
+    int i = 0, bucket = 0;
+    for (i = 0; i < MAP_TUNER_STATS * MAP_TUNER_LEVELS; i++)
+    {
+        int difference = 0;
+        for (bucket = 0; bucket < MAP_TUNER_BUCKETS; bucket++)
+            difference += abs(histogram[i * MAP_TUNER_BUCKETS + bucket] - map_tuner_reference[i * MAP_TUNER_BUCKETS + bucket]);
+
+        distance += difference * 0.5 / MAP_TUNER_FLOORS_PER_LEVEL;
+    }
+
+    return 1 - distance / (MAP_TUNER_STATS * MAP_TUNER_LEVELS);
+}
+
+// config is on the front if no other config needs fewer (or as many) attempts while being more (or as) similar
+void map_tuner_find_pareto_front()
+{
+    int i = 0, j = 0;
+    for (i = 0; i < map_tuner_configs_count; i++)
+    {
+        MapTunerConfig *config = &map_tuner_configs[i];
+        config->pareto = false;
+        if (config->failed > 0)
+            continue;
+
+        config->pareto = true;
+
+        for (j = 0; j < map_tuner_configs_count; j++)
+        {
+            MapTunerConfig *other = &map_tuner_configs[j];
+            if (j == i || other->failed > 0)
+                continue;
+
+            if (other->attempts_per_floor > config->attempts_per_floor || other->similarity < config->similarity)
+                continue;
+
+            if (other->attempts_per_floor < config->attempts_per_floor || other->similarity > config->similarity)
+            {
+                config->pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+void map_tuner_write_config(var file, MapTunerConfig *config)
+{
+    file_str_write(file, str_printf(NULL, "attempts per floor=%.3f; similarity=%.4f; failed=%d; ", (double)config->attempts_per_floor, (double)config->similarity,
+                                     (long)config->failed));
+    file_str_write(file, str_printf(NULL, "grow_skip=%d; rooms_base=%d; rooms_spread=%d; rooms_per_level=%d; secrets_spread=%d; item_rooms_spread=%d; revive=%d;\n",
+                                     (long)config->values[MAP_TUNER_GROW_SKIP], (long)config->values[MAP_TUNER_ROOMS_BASE],
+                                     (long)config->values[MAP_TUNER_ROOMS_SPREAD], (long)config->values[MAP_TUNER_ROOMS_PER_LEVEL],
+                                     (long)config->values[MAP_TUNER_SECRETS_SPREAD], (long)config->values[MAP_TUNER_ITEM_ROOMS_SPREAD],
+                                     (long)config->values[MAP_TUNER_REVIVE]));
+}
+
+void map_tuner_write(char *file_name, double default_attempts)
+{
+    var file = file_open_write(file_name);
+    if (!file)
+        return;
+
+    file_str_write(file, str_printf(NULL, "configurations=%d;\nfloors per level=%d;\ndefault attempts per floor=%.3f;\n", (long)map_tuner_configs_count,
+                                     (long)MAP_TUNER_FLOORS_PER_LEVEL, (double)default_attempts));
+
+    // front from the fewest attempts up
+    file_str_write(file, "\npareto front:\n");
+
+    int written = 0, i = 0;
+    while (true)
+    {
+        MapTunerConfig *next = NULL;
+        for (i = 0; i < map_tuner_configs_count; i++)
+        {
+            MapTunerConfig *config = &map_tuner_configs[i];
+            if (config->pareto != true)
+                continue;
+
+            if (next && next->attempts_per_floor <= config->attempts_per_floor)
+                continue;
+
+            next = config;
+        }
+
+        if (!next)
+            break;
+
+        map_tuner_write_config(file, next);
+
+        // written ones are marked, so they aren't picked again
+        next->pareto = 2;
+        written++;
+    }
+
+    file_str_write(file, "\nall configurations:\n");
+    for (i = 0; i < map_tuner_configs_count; i++)
+        map_tuner_write_config(file, &map_tuner_configs[i]);
+
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+
+    int i = 0, level = 0;
+    for (i = 0; i < MAP_TUNER_PARAMS; i++)
+        map_tuner_default[i] = map_tuner_param_get(i);
+
+    // statistics everything is compared with
+    int default_attempts = 0;
+    memset(map_tuner_reference, 0, sizeof(int) * MAP_TUNER_HISTOGRAM_SIZE);
+    for (level = 0; level < MAP_TUNER_LEVELS; level++)
+        default_attempts += map_tuner_measure_level(map_tuner_reference, level);
+
+    map_tuner_create_configs();
+
+    for (i = 0; i < map_tuner_configs_count; i++)
+    {
+        MapTunerConfig *config = &map_tuner_configs[i];
+        map_tuner_apply(config->values);
+
+        int attempts = 0;
+        memset(map_tuner_histogram, 0, sizeof(int) * MAP_TUNER_HISTOGRAM_SIZE);
+        for (level = 0; level < MAP_TUNER_LEVELS; level++)
+        {
+            attempts += map_tuner_measure_level(map_tuner_histogram, level);
+            config->failed = map_tuner_failed;
+
+            draw_text(str_printf(NULL, "configuration=%d/%d;\nlevel=%d;", (long)(i + 1), (long)map_tuner_configs_count, (long)level), 10, 10, COLOR_RED);
+            wait(1);
+
+            if (key_esc)
+                return;
+
+            if (config->failed)
+                break;
+        }
+
+        if (config->failed)
+            continue;
+
+        config->attempts_per_floor = attempts / (double)(MAP_TUNER_FLOORS_PER_LEVEL * MAP_TUNER_LEVELS);
+        config->similarity = map_tuner_similarity(map_tuner_histogram);
+    }
+
+    map_tuner_apply(map_tuner_default);
+
+    map_tuner_find_pareto_front();
+    map_tuner_write("map_tuner.txt", default_attempts / (double)(MAP_TUNER_FLOORS_PER_LEVEL * MAP_TUNER_LEVELS));
+
+    while (!key_esc)
+    {
+        draw_text("done, map_tuner.txt is written", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
@@ -0,0 +1,118 @@
+// in-game profiler overlay (toggled with p)
+// shows stage times of the last generated floor, a histogram of the last MAP_TIMED_FLOORS generation times
+// and how long map_draw takes every frame, all timings come from map_clock_update (dtimer)
+
+// histogram bin b holds floors that took 2^b ... 2^(b+1) microseconds (last bin takes everything slower)
+#define PROFILE_OVERLAY_BINS 16
+#define PROFILE_OVERLAY_BIN_WIDTH 12
+#define PROFILE_OVERLAY_BAR_HEIGHT 64
+
+// running average of map_draw weighs the last frame with 1 / PROFILE_OVERLAY_DRAW_SMOOTHING
+#define PROFILE_OVERLAY_DRAW_SMOOTHING 32
+
+typedef struct ProfileOverlay
+{
+    int visible;
+
+    // map_draw time of the last frame, it's running average and the slowest frame since the overlay was shown (in microseconds)
+    double draw_time;
+    double draw_average;
+    double draw_max;
+
+    int bins[PROFILE_OVERLAY_BINS];
+} ProfileOverlay;
+
+ProfileOverlay profile_overlay;
+
+void profile_overlay_toggle()
+{
+    profile_overlay.visible = !profile_overlay.visible;
+
+    // stages are only timed while someone looks at them
+    map_stage_timing = profile_overlay.visible;
+
+    profile_overlay.draw_average = 0;
+    profile_overlay.draw_max = 0;
+}
+
+void profile_overlay_add_draw_time(double microseconds)
+{
+    profile_overlay.draw_time = microseconds;
+    profile_overlay.draw_average += (microseconds - profile_overlay.draw_average) / PROFILE_OVERLAY_DRAW_SMOOTHING;
+
+    if (microseconds > profile_overlay.draw_max)
+        profile_overlay.draw_max = microseconds;
+}
+
+int profile_overlay_bin(double microseconds)
+{
+    int bin = 0;
+    while (microseconds >= 2 && bin < PROFILE_OVERLAY_BINS - 1)
+    {
+        microseconds = microseconds / 2;
+        bin++;
+    }
+
+    return bin;
+}
+
+// fills the histogram from the ring buffer of generation times, returns amount of floors in it
+int profile_overlay_fill_bins()
+{
+    int i = 0;
+    for (i = 0; i < PROFILE_OVERLAY_BINS; i++)
+        profile_overlay.bins[i] = 0;
+
+    int count = map_timed_floors;
+    if (count > MAP_TIMED_FLOORS)
+        count = MAP_TIMED_FLOORS;
+
+    for (i = 0; i < count; i++)
+        profile_overlay.bins[profile_overlay_bin(map_timed_floor_time[i])]++;
+
+    return count;
+}
+
+void profile_overlay_draw(int pos_x, int pos_y)
+{
+    if (!profile_overlay.visible)
+        return;
+
+    draw_text(str_printf(NULL, "last floor=%dus;\nattempts=%d;\nmap_draw=%dus (avg %dus, max %dus);", (long)map_last_floor_time,
+                         (long)map_last_floor_attempts, (long)profile_overlay.draw_time, (long)profile_overlay.draw_average, (long)profile_overlay.draw_max),
+              pos_x, pos_y, COLOR_RED);
+
+    pos_y += 56;
+
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+    {
+        draw_text(str_printf(NULL, "%s=%dus;", map_stage_name(i), (long)map_last_floor_stage_time[i]), pos_x, pos_y, COLOR_RED);
+        pos_y += 16;
+    }
+
+    pos_y += 8;
+
+    int count = profile_overlay_fill_bins();
+    draw_text(str_printf(NULL, "last %d floors (1us ... 32ms):", (long)count), pos_x, pos_y, COLOR_RED);
+    pos_y += 20;
+
+    int most = 1;
+    for (i = 0; i < PROFILE_OVERLAY_BINS; i++)
+    {
+        if (profile_overlay.bins[i] > most)
+            most = profile_overlay.bins[i];
+    }
+
+    draw_quad(NULL, vector(pos_x, pos_y, 0), NULL, vector(PROFILE_OVERLAY_BINS * PROFILE_OVERLAY_BIN_WIDTH, PROFILE_OVERLAY_BAR_HEIGHT, 0), NULL, vector(0, 0, 0), 50, 0);
+
+    for (i = 0; i < PROFILE_OVERLAY_BINS; i++)
+    {
+        var height = profile_overlay.bins[i] * PROFILE_OVERLAY_BAR_HEIGHT / most;
+        if (height <= 0)
+            continue;
+
+        draw_quad(NULL, vector(pos_x + i * PROFILE_OVERLAY_BIN_WIDTH + 1, pos_y + PROFILE_OVERLAY_BAR_HEIGHT - height, 0), NULL,
+                  vector(PROFILE_OVERLAY_BIN_WIDTH - 2, height, 0), NULL, COLOR_GREEN, 100, 0);
+    }
+}
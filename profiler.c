@@ -0,0 +1,230 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+
+// floors generated for each level id (0 ... max_level_id)
+#define PROFILER_FLOORS_PER_LEVEL 1000000
+#define PROFILER_FLOORS_PER_FRAME 500
+#define PROFILER_FIRST_SEED 1
+
+// histograms have one bucket per value, bigger values go into the last bucket
+#define PROFILER_BUCKETS 64
+
+// each map cell becomes a square of this many pixels in the heatmap images
+#define PROFILER_HEATMAP_SCALE 8
+
+int profiler_floors = 0;
+int profiler_attempts = 0;
+int profiler_unreachable_boss = 0;
+
+int profiler_rooms[PROFILER_BUCKETS];
+int profiler_end_rooms[PROFILER_BUCKETS];
+int profiler_boss_depth[PROFILER_BUCKETS];
+int profiler_secret_chance[PROFILER_BUCKETS];
+
+// per room type heatmaps, stored as type * FLOOR_CELLS + cell
+int profiler_heat[ROOM_TYPES * FLOOR_CELLS];
+int profiler_occupancy[FLOOR_CELLS];
+
+int profiler_depth[FLOOR_CELLS];
+
+Floor profiler_floor;
+
+void profiler_reset()
+{
+    profiler_floors = 0;
+    profiler_attempts = 0;
+    profiler_unreachable_boss = 0;
+
+    memset(profiler_rooms, 0, sizeof(int) * PROFILER_BUCKETS);
+    memset(profiler_end_rooms, 0, sizeof(int) * PROFILER_BUCKETS);
+    memset(profiler_boss_depth, 0, sizeof(int) * PROFILER_BUCKETS);
+    memset(profiler_secret_chance, 0, sizeof(int) * PROFILER_BUCKETS);
+    memset(profiler_heat, 0, sizeof(int) * ROOM_TYPES * FLOOR_CELLS);
+
+    map_reset_stage_rejections();
+}
+
+void profiler_histogram_add(int *histogram, int value)
+{
+    int bucket = clamp(value, 0, PROFILER_BUCKETS - 1);
+    histogram[bucket]++;
+}
+
+void profiler_add_floor(Floor *floor)
+{
+    // heatmaps and secret chances are accumulated in a single straight pass over the cells
+    // type doubles as the heatmap index, so there are no per type branches here
+    unsigned char *type = floor->type;
+    unsigned char *secret_chance = floor->secret_chance;
+
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+    {
+        profiler_heat[type[cell] * FLOOR_CELLS + cell]++;
+        profiler_secret_chance[secret_chance[cell]]++;
+    }
+
+    profiler_histogram_add(profiler_rooms, floor->rooms);
+    profiler_histogram_add(profiler_end_rooms, floor->end_rooms);
+
+    int boss_cell = floor_find_room(floor, ROOM_BOSS);
+    floor_depths(floor, floor_start_cell(), profiler_depth);
+    if (boss_cell >= 0 && profiler_depth[boss_cell] >= 0)
+        profiler_histogram_add(profiler_boss_depth, profiler_depth[boss_cell]);
+    else
+        profiler_unreachable_boss++;
+
+    profiler_attempts += floor->attempts;
+    profiler_floors++;
+}
+
+void profiler_write_histogram(var file, char *name, int *histogram, int first_bucket)
+{
+    file_str_write(file, str_printf(NULL, "\n%s:\n", name));
+
+    int total = 0, i = 0;
+    for (i = first_bucket; i < PROFILER_BUCKETS; i++)
+        total += histogram[i];
+
+    if (total <= 0)
+        return;
+
+    for (i = first_bucket; i < PROFILER_BUCKETS; i++)
+    {
+        if (histogram[i] <= 0)
+            continue;
+
+        file_str_write(file, str_printf(NULL, "%4d %10d %6.2f%%\n", (long)i, (long)histogram[i], (double)(histogram[i] * 100.0 / total)));
+    }
+}
+
+// count / total in double (counts go past the range of var), 0 while there is no total
+double profiler_ratio(double count, int total)
+{
+    if (total <= 0)
+        return 0;
+
+    return count / total;
+}
+
+void profiler_write_summary(char *file_name)
+{
+    var file = file_open_write(file_name);
+    if (!file)
+        return;
+
+    file_str_write(file, str_printf(NULL, "level=%d;\nfloors=%d;\nattempts=%d;\nattempts per floor=%.3f;\n",
+                                     (long)level_id, (long)profiler_floors, (long)profiler_attempts,
+                                     profiler_ratio(profiler_attempts, profiler_floors)));
+
+    file_str_write(file, "\nrejections by stage:\n");
+
+    int i = 0;
+    for (i = 0; i < MAP_STAGES; i++)
+    {
+        file_str_write(file, str_printf(NULL, "%-24s %10d %6.2f%%\n", map_stage_name(i), (long)map_stage_rejections[i],
+                                         profiler_ratio(map_stage_rejections[i] * 100.0, profiler_attempts)));
+    }
+
+    profiler_write_histogram(file, "rooms", profiler_rooms, 0);
+    profiler_write_histogram(file, "end rooms", profiler_end_rooms, 0);
+    profiler_write_histogram(file, "boss depth", profiler_boss_depth, 0);
+    profiler_write_histogram(file, "secret chance", profiler_secret_chance, 1);
+
+    file_str_write(file, str_printf(NULL, "\nunreachable boss=%d;\n", (long)profiler_unreachable_boss));
+    file_close(file);
+}
+
+// writes binary greyscale image, brightest pixel is the most visited cell
+void profiler_write_pgm(char *file_name, int *values)
+{
+    var file = file_open_write(file_name);
+    if (!file)
+        return;
+
+    int max_value = 1, cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+        max_value = maxv(max_value, values[cell]);
+
+    int width = MAP_WIDTH * PROFILER_HEATMAP_SCALE;
+    int height = MAP_HEIGHT * PROFILER_HEATMAP_SCALE;
+    file_str_write(file, str_printf(NULL, "P5\n%d %d\n255\n", (long)width, (long)height));
+
+    int x = 0, y = 0;
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            cell = floor_cell(x / PROFILER_HEATMAP_SCALE, y / PROFILER_HEATMAP_SCALE);
+            file_asc_write(file, (values[cell] * 255.0) / max_value);
+        }
+    }
+
+    file_close(file);
+}
+
+void profiler_write_heatmaps()
+{
+    int cell = 0;
+    for (cell = 0; cell < FLOOR_CELLS; cell++)
+        profiler_occupancy[cell] = profiler_floors - profiler_heat[ROOM_NONE * FLOOR_CELLS + cell];
+
+    profiler_write_pgm(_chr(str_printf(NULL, "heatmap_level_%d_all.pgm", (long)level_id)), profiler_occupancy);
+
+    int type = 0;
+    for (type = ROOM_NORMAL; type < ROOM_TYPES; type++)
+        profiler_write_pgm(_chr(str_printf(NULL, "heatmap_level_%d_type_%d.pgm", (long)level_id, (long)type)), &profiler_heat[type * FLOOR_CELLS]);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+
+    int seed = PROFILER_FIRST_SEED;
+    for (level_id = 0; level_id <= max_level_id; level_id++)
+    {
+        profiler_reset();
+
+        // generation is time sliced over frames, so the window stays responsive
+        while (profiler_floors < PROFILER_FLOORS_PER_LEVEL)
+        {
+            int i = 0;
+            for (i = 0; i < PROFILER_FLOORS_PER_FRAME && profiler_floors < PROFILER_FLOORS_PER_LEVEL; i++)
+            {
+                map_generate_seeded(seed);
+                seed++;
+
+                map_floor_save(&profiler_floor);
+                profiler_add_floor(&profiler_floor);
+            }
+
+            draw_text(str_printf(NULL, "level=%d;\nfloors=%d/%d;", (long)level_id, (long)profiler_floors, (long)PROFILER_FLOORS_PER_LEVEL), 10, 10, COLOR_RED);
+            wait(1);
+
+            if (key_esc)
+                return;
+        }
+
+        profiler_write_summary(_chr(str_printf(NULL, "profiler_level_%d.txt", (long)level_id)));
+        profiler_write_heatmaps();
+    }
+
+    while (!key_esc)
+    {
+        draw_text("done, results written to profiler_level_*.txt and heatmap_level_*.pgm", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
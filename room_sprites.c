@@ -0,0 +1,74 @@
+// room sprites, one for every door mask, all of them in a single atlas bitmap
+// atlas is made from pixels compiled in (rooms_pcx.c, made by rooms_pcx_export.c), so there is no file to load
+#include "rooms_pcx.c"
+
+BMAP *room_sprites;
+
+// locked 8888 bitmap is written straight through it's pixel memory (0xAARRGGBB), one int per pixel
+void room_sprites_copy(BMAP *bmap)
+{
+    int *pixels = bmap->finalbits;
+
+    int x = 0, y = 0;
+    for (y = 0; y < ROOMS_PCX_HEIGHT; y++)
+    {
+        int *row = &pixels[y * bmap->finalwidth];
+        int *src = &rooms_pcx_pixels[y * ROOMS_PCX_WIDTH];
+
+        for (x = 0; x < ROOMS_PCX_WIDTH; x++)
+            row[x] = src[x] | 0xFF000000;
+    }
+}
+
+// any other format goes through the engine, a pixel_to_bmap call for every pixel
+void room_sprites_convert(BMAP *bmap, var format)
+{
+    int x = 0, y = 0;
+    for (y = 0; y < ROOMS_PCX_HEIGHT; y++)
+    {
+        for (x = 0; x < ROOMS_PCX_WIDTH; x++)
+        {
+            int rgb = rooms_pcx_pixels[x + y * ROOMS_PCX_WIDTH];
+
+            // colors are blue, green, red
+            VECTOR color;
+            vec_set(&color, vector(rgb & 255, (rgb >> 8) & 255, (rgb >> 16) & 255));
+            pixel_to_bmap(bmap, x, y, pixel_for_vec(&color, 100, format));
+        }
+    }
+}
+
+void room_sprites_create()
+{
+    if (room_sprites)
+        return;
+
+    room_sprites = bmap_createblack(ROOMS_PCX_WIDTH, ROOMS_PCX_HEIGHT, 8888);
+    if (!room_sprites)
+        return;
+
+    var format = bmap_lock(room_sprites, 0);
+
+    if (format == 8888 && room_sprites->finalbits)
+        room_sprites_copy(room_sprites);
+    else
+        room_sprites_convert(room_sprites, format);
+
+    bmap_unlock(room_sprites);
+}
+
+void room_sprites_destroy()
+{
+    safe_remove(room_sprites);
+}
+
+// draws sprite of the given door mask (DOOR_* bits), scaled up from ROOMS_PCX_SPRITE_SIZE pixels
+void room_sprite_draw(int doors, VECTOR *pos, var scale, VECTOR *color, var alpha)
+{
+    if (!room_sprites)
+        return;
+
+    int index = doors & 15;
+    draw_quad(room_sprites, pos, vector(rooms_pcx_sprite_x[index], rooms_pcx_sprite_y[index], 0), vector(ROOMS_PCX_SPRITE_SIZE, ROOMS_PCX_SPRITE_SIZE, 0),
+              vector(scale, scale, 0), color, alpha, 0);
+}
@@ -0,0 +1,469 @@
+// interior size of a single room (in cells)
+#define ROOM_INTERIOR_WIDTH 13
+#define ROOM_INTERIOR_HEIGHT 7
+#define ROOM_INTERIOR_CELLS (ROOM_INTERIOR_WIDTH * ROOM_INTERIOR_HEIGHT)
+
+// interior cell kinds
+#define ROOM_CELL_FLOOR 0
+#define ROOM_CELL_ROCK 1
+#define ROOM_CELL_PIT 2
+#define ROOM_CELL_SPIKES 3
+#define ROOM_CELL_ENEMY 4
+#define ROOM_CELL_PICKUP 5
+#define ROOM_CELL_BOSS 6
+#define ROOM_CELL_ITEM 7
+#define ROOM_CELL_SHOP_ITEM 8
+#define ROOM_CELL_MAYBE_ROCK 9
+#define ROOM_CELL_KINDS 10
+
+#define ROOM_TEMPLATES_MAX 64
+
+// every template is used as is, mirrored horizontally, vertically and both
+#define ROOM_TEMPLATE_MIRRORS 4
+#define ROOM_TEMPLATE_MIRROR_X 1
+#define ROOM_TEMPLATE_MIRROR_Y 2
+
+// door masks a room can have (DOOR_TOP | DOOR_RIGHT | DOOR_BOTTOM | DOOR_LEFT)
+#define ROOM_DOOR_MASKS 16
+
+// packed read-only template table, filled once by room_templates_load
+unsigned char room_templates_cells[ROOM_TEMPLATES_MAX * ROOM_INTERIOR_CELLS];
+unsigned char room_templates_type[ROOM_TEMPLATES_MAX];
+
+// doors each template keeps free (before mirroring)
+unsigned char room_templates_open[ROOM_TEMPLATES_MAX];
+int room_templates_count = 0;
+
+// templates that fit each room type and door mask, refs are template * ROOM_TEMPLATE_MIRRORS + mirror
+short room_templates_first[ROOM_TYPES * ROOM_DOOR_MASKS];
+short room_templates_fitting[ROOM_TYPES * ROOM_DOOR_MASKS];
+
+// every template is of one type only, so it can show up under each door mask once per mirror at most
+short room_templates_refs[ROOM_DOOR_MASKS * ROOM_TEMPLATES_MAX * ROOM_TEMPLATE_MIRRORS];
+
+// interior of a single room, instantiated the first time the room is entered
+typedef struct RoomInterior
+{
+    // equals owner's stamp while the interior is valid
+    int stamp;
+    int ref;
+    unsigned char cells[ROOM_INTERIOR_CELLS];
+} RoomInterior;
+
+// lazily filled interiors of all rooms of one floor
+typedef struct RoomInteriors
+{
+    int stamp;
+    int seed;
+    int level_id;
+    RoomInterior rooms[FLOOR_CELLS];
+} RoomInteriors;
+
+int room_interior_cell(int x, int y)
+{
+    return x + y * ROOM_INTERIOR_WIDTH;
+}
+
+// interior cell right in front of the given door
+int room_interior_door_cell(int door)
+{
+    switch (door)
+    {
+    case DOOR_TOP:
+        return room_interior_cell(ROOM_INTERIOR_WIDTH / 2, 0);
+
+    case DOOR_RIGHT:
+        return room_interior_cell(ROOM_INTERIOR_WIDTH - 1, ROOM_INTERIOR_HEIGHT / 2);
+
+    case DOOR_BOTTOM:
+        return room_interior_cell(ROOM_INTERIOR_WIDTH / 2, ROOM_INTERIOR_HEIGHT - 1);
+    }
+
+    return room_interior_cell(0, ROOM_INTERIOR_HEIGHT / 2);
+}
+
+int is_room_cell_walkable(int kind)
+{
+    if (kind == ROOM_CELL_ROCK || kind == ROOM_CELL_PIT || kind == ROOM_CELL_MAYBE_ROCK)
+        return false;
+
+    return true;
+}
+
+int room_cell_kind_from_char(int c)
+{
+    switch (c)
+    {
+    case '#':
+        return ROOM_CELL_ROCK;
+
+    case 'o':
+        return ROOM_CELL_PIT;
+
+    case '^':
+        return ROOM_CELL_SPIKES;
+
+    case 'e':
+        return ROOM_CELL_ENEMY;
+
+    case '$':
+        return ROOM_CELL_PICKUP;
+
+    case 'B':
+        return ROOM_CELL_BOSS;
+
+    case 'I':
+        return ROOM_CELL_ITEM;
+
+    case 'S':
+        return ROOM_CELL_SHOP_ITEM;
+
+    case '?':
+        return ROOM_CELL_MAYBE_ROCK;
+    }
+
+    return ROOM_CELL_FLOOR;
+}
+
+// door mask after mirroring
+int room_template_mirror_doors(int doors, int mirror)
+{
+    int result = doors & (DOOR_TOP | DOOR_BOTTOM | DOOR_RIGHT | DOOR_LEFT);
+
+    if (mirror & ROOM_TEMPLATE_MIRROR_X)
+    {
+        result &= ~(DOOR_RIGHT | DOOR_LEFT);
+        if (doors & DOOR_RIGHT)
+            result |= DOOR_LEFT;
+        if (doors & DOOR_LEFT)
+            result |= DOOR_RIGHT;
+    }
+
+    if (mirror & ROOM_TEMPLATE_MIRROR_Y)
+    {
+        result &= ~(DOOR_TOP | DOOR_BOTTOM);
+        if (doors & DOOR_TOP)
+            result |= DOOR_BOTTOM;
+        if (doors & DOOR_BOTTOM)
+            result |= DOOR_TOP;
+    }
+
+    return result;
+}
+
+// doors of the template that are free and can be reached from each other
+int room_template_open_doors(unsigned char *cells)
+{
+    unsigned char reached[ROOM_INTERIOR_CELLS];
+    short stack[ROOM_INTERIOR_CELLS];
+    memset(reached, 0, ROOM_INTERIOR_CELLS);
+
+    int doors = 0, count = 0, filled = false;
+
+    int n = 0;
+    for (n = 0; n < CARDINAL_DIRECTIONS; n++)
+    {
+        int door = 1 << n;
+        int cell = room_interior_door_cell(door);
+        if (!is_room_cell_walkable(cells[cell]))
+            continue;
+
+        // first free door starts the flood fill, the rest only count if it got to them
+        if (!filled)
+        {
+            filled = true;
+
+            reached[cell] = true;
+            stack[count] = cell;
+            count++;
+
+            while (count > 0)
+            {
+                count--;
+                int x = stack[count] % ROOM_INTERIOR_WIDTH;
+                int y = stack[count] / ROOM_INTERIOR_WIDTH;
+
+                int i = 0;
+                for (i = 0; i < CARDINAL_DIRECTIONS; i++)
+                {
+                    int nx = x + cardinal_dx[i];
+                    int ny = y + cardinal_dy[i];
+                    if (nx < 0 || ny < 0 || nx >= ROOM_INTERIOR_WIDTH || ny >= ROOM_INTERIOR_HEIGHT)
+                        continue;
+
+                    int next = room_interior_cell(nx, ny);
+                    if (reached[next] || !is_room_cell_walkable(cells[next]))
+                        continue;
+
+                    reached[next] = true;
+                    stack[count] = next;
+                    count++;
+                }
+            }
+        }
+
+        if (reached[cell])
+            doors |= door;
+    }
+
+    return doors;
+}
+
+int room_templates_line_is(char *line, char *name)
+{
+    int i = 0;
+    while (name[i] != 0)
+    {
+        if (line[i] != name[i])
+            return false;
+
+        i++;
+    }
+
+    return line[i] == 0;
+}
+
+// returns room type named by the line, or -1
+int room_templates_line_type(char *line)
+{
+    if (room_templates_line_is(line, "normal"))
+        return ROOM_NORMAL;
+
+    if (room_templates_line_is(line, "start"))
+        return ROOM_START;
+
+    if (room_templates_line_is(line, "boss"))
+        return ROOM_BOSS;
+
+    if (room_templates_line_is(line, "special"))
+        return ROOM_SPECIAL;
+
+    if (room_templates_line_is(line, "locked"))
+        return ROOM_LOCKED;
+
+    if (room_templates_line_is(line, "secret"))
+        return ROOM_SECRET;
+
+    if (room_templates_line_is(line, "super_secret"))
+        return ROOM_SUPER_SECRET;
+
+    return -1;
+}
+
+// builds type + door mask index, so picking a template for a room is a single lookup
+void room_templates_index()
+{
+    int refs = 0;
+
+    int type = 0, doors = 0;
+    for (type = 0; type < ROOM_TYPES; type++)
+    {
+        for (doors = 0; doors < ROOM_DOOR_MASKS; doors++)
+        {
+            int index = type * ROOM_DOOR_MASKS + doors;
+            room_templates_first[index] = refs;
+
+            int i = 0, mirror = 0;
+            for (i = 0; i < room_templates_count; i++)
+            {
+                if (room_templates_type[i] != type)
+                    continue;
+
+                for (mirror = 0; mirror < ROOM_TEMPLATE_MIRRORS; mirror++)
+                {
+                    int open = room_template_mirror_doors(room_templates_open[i], mirror);
+                    if ((doors & ~open) != 0)
+                        continue;
+
+                    room_templates_refs[refs] = i * ROOM_TEMPLATE_MIRRORS + mirror;
+                    refs++;
+                }
+            }
+
+            room_templates_fitting[index] = refs - room_templates_first[index];
+        }
+    }
+}
+
+void room_templates_add(int type, unsigned char *cells)
+{
+    if (room_templates_count >= ROOM_TEMPLATES_MAX)
+    {
+        error("room_templates_add: too many room templates!");
+        return;
+    }
+
+    int index = room_templates_count;
+    memcpy(&room_templates_cells[index * ROOM_INTERIOR_CELLS], cells, ROOM_INTERIOR_CELLS);
+    room_templates_type[index] = type;
+    room_templates_open[index] = room_template_open_doors(cells);
+    room_templates_count++;
+}
+
+// loads all templates from the given text file and indexes them, returns amount of loaded templates
+int room_templates_load(char *file_name)
+{
+    room_templates_count = 0;
+
+    var file = file_open_read(file_name);
+    if (!file)
+    {
+        error("room_templates_load: can't open room templates file!");
+        room_templates_index();
+        return 0;
+    }
+
+    char line[64];
+    unsigned char cells[ROOM_INTERIOR_CELLS];
+
+    int length = 0, type = -1, row = 0, done = false;
+    while (!done)
+    {
+        int c = file_asc_read(file);
+        if (c < 0)
+            done = true;
+
+        if (c == '\r')
+            continue;
+
+        if (c != '\n' && !done)
+        {
+            if (length < 63)
+            {
+                line[length] = c;
+                length++;
+            }
+
+            continue;
+        }
+
+        line[length] = 0;
+        length = 0;
+
+        // empty lines and comments
+        if (line[0] == 0)
+            continue;
+
+        if (line[0] == '/' && line[1] == '/')
+            continue;
+
+        int line_type = room_templates_line_type(line);
+        if (line_type >= 0)
+        {
+            type = line_type;
+            row = 0;
+            continue;
+        }
+
+        if (type < 0 || row >= ROOM_INTERIOR_HEIGHT)
+            continue;
+
+        // chars after the end of a short row are left over from longer lines, so they are rock
+        int ended = false;
+
+        int x = 0;
+        for (x = 0; x < ROOM_INTERIOR_WIDTH; x++)
+        {
+            if (x >= 63 || line[x] == 0)
+                ended = true;
+
+            int kind = ROOM_CELL_ROCK;
+            if (!ended)
+                kind = room_cell_kind_from_char(line[x]);
+
+            cells[room_interior_cell(x, row)] = kind;
+        }
+
+        row++;
+        if (row >= ROOM_INTERIOR_HEIGHT)
+            room_templates_add(type, cells);
+    }
+
+    file_close(file);
+
+    room_templates_index();
+    return room_templates_count;
+}
+
+// forgets all instantiated interiors, cost doesn't depend on the amount of rooms
+void room_interiors_reset(RoomInteriors *interiors, Floor *floor)
+{
+    if (!interiors || !floor)
+        return;
+
+    interiors->stamp++;
+    interiors->seed = floor->seed;
+    interiors->level_id = floor->level_id;
+}
+
+// fills room's interior from a fitting template, the result only depends on floor's seed, level and room's cell
+void room_interior_instantiate(RoomInterior *interior, Floor *floor, int cell)
+{
+    int type = floor->type[cell];
+    int doors = (floor->doors[cell] | (floor->doors[cell] >> DOOR_SECRET_SHIFT) | floor->links[cell]) & (ROOM_DOOR_MASKS - 1);
+
+    unsigned long rng = hash_mix(floor->seed ^ hash_mix(cell + floor->level_id * FLOOR_CELLS + 0x6A09E667));
+    if (rng == 0)
+        rng = 0x9E3779B9;
+
+    memset(interior->cells, ROOM_CELL_FLOOR, ROOM_INTERIOR_CELLS);
+    interior->ref = -1;
+
+    int index = clamp(type, 0, ROOM_TYPES - 1) * ROOM_DOOR_MASKS + doors;
+    if (room_templates_fitting[index] <= 0)
+        return;
+
+    interior->ref = room_templates_refs[room_templates_first[index] + rng_range(&rng, room_templates_fitting[index])];
+
+    int mirror = interior->ref % ROOM_TEMPLATE_MIRRORS;
+    unsigned char *cells = &room_templates_cells[(interior->ref / ROOM_TEMPLATE_MIRRORS) * ROOM_INTERIOR_CELLS];
+
+    int x = 0, y = 0;
+    for (y = 0; y < ROOM_INTERIOR_HEIGHT; y++)
+    {
+        for (x = 0; x < ROOM_INTERIOR_WIDTH; x++)
+        {
+            int src_x = x, src_y = y;
+            if (mirror & ROOM_TEMPLATE_MIRROR_X)
+                src_x = ROOM_INTERIOR_WIDTH - 1 - x;
+            if (mirror & ROOM_TEMPLATE_MIRROR_Y)
+                src_y = ROOM_INTERIOR_HEIGHT - 1 - y;
+
+            int kind = cells[room_interior_cell(src_x, src_y)];
+            if (kind == ROOM_CELL_MAYBE_ROCK)
+            {
+                kind = ROOM_CELL_FLOOR;
+                if (rng_range(&rng, 2) == 0)
+                    kind = ROOM_CELL_ROCK;
+            }
+
+            interior->cells[room_interior_cell(x, y)] = kind;
+        }
+    }
+}
+
+// returns interior of the room at the given cell, it's made the first time the room is asked for
+RoomInterior *room_interior_get(RoomInteriors *interiors, Floor *floor, int cell)
+{
+    if (!interiors || !floor)
+        return NULL;
+
+    if (cell < 0 || cell >= FLOOR_CELLS)
+        return NULL;
+
+    if (floor->type[cell] == ROOM_NONE)
+        return NULL;
+
+    // never used or floor changed without a reset
+    if (interiors->stamp == 0 || interiors->seed != floor->seed || interiors->level_id != floor->level_id)
+        room_interiors_reset(interiors, floor);
+
+    RoomInterior *interior = &interiors->rooms[cell];
+    if (interior->stamp != interiors->stamp)
+    {
+        room_interior_instantiate(interior, floor, cell);
+        interior->stamp = interiors->stamp;
+    }
+
+    return interior;
+}
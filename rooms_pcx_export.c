@@ -0,0 +1,203 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "room_sprites.c"
+
+// converts rooms.pcx into rooms_pcx.c (pixels and sprite corners), run it again whenever rooms.pcx changes
+// afterwards it measures how long it takes to make the room sprites from the file (the old way) and from the compiled in pixels
+// and writes the times into rooms_pcx_timing.txt (times are only meaningful once rooms_pcx.c is up to date and compiled in)
+
+// rooms.pcx has 4x4 sprites, in this order:
+// up, right, bottom, left
+// up-right, right-bottom, bottom-left, left-up
+// left-up-right, up-right-bottom, right-bottom-left, bottom-left-up
+// up-bottom, left-right, all-sides, none
+#define ROOMS_PCX_EXPORT_SPRITES 16
+#define ROOMS_PCX_EXPORT_COLUMNS 4
+#define ROOMS_PCX_EXPORT_SPRITE_SIZE 16
+
+// sprite of every door mask (top 1, right 2, bottom 4, left 8)
+int rooms_pcx_export_sprite[ROOMS_PCX_EXPORT_SPRITES] = {15, 0, 1, 4, 2, 12, 5, 9, 3, 7, 13, 8, 6, 11, 10, 14};
+
+// how many times each way of making the sprites is timed
+#define ROOMS_PCX_EXPORT_RUNS 32
+
+// first run (cold) and average of all runs, in microseconds
+double rooms_pcx_export_file_first = 0;
+double rooms_pcx_export_file_average = 0;
+double rooms_pcx_export_embedded_first = 0;
+double rooms_pcx_export_embedded_average = 0;
+
+void rooms_pcx_export_write(BMAP *pcx)
+{
+    var file = file_open_write("rooms_pcx.c");
+    if (!file)
+        return;
+
+    int width = bmap_width(pcx);
+    int height = bmap_height(pcx);
+
+    file_str_write(file, "// generated from rooms.pcx by rooms_pcx_export.c, don't edit\n");
+    file_str_write(file, str_printf(NULL, "#define ROOMS_PCX_WIDTH %d\n", (long)width));
+    file_str_write(file, str_printf(NULL, "#define ROOMS_PCX_HEIGHT %d\n", (long)height));
+    file_str_write(file, str_printf(NULL, "#define ROOMS_PCX_SPRITE_SIZE %d\n", (long)ROOMS_PCX_EXPORT_SPRITE_SIZE));
+
+    file_str_write(file, "\n// top left corner of the sprite for every door mask (DOOR_* bits)\n");
+
+    int i = 0, axis = 0;
+    for (axis = 0; axis < 2; axis++)
+    {
+        if (axis == 0)
+            file_str_write(file, str_printf(NULL, "int rooms_pcx_sprite_x[%d] = {", (long)ROOMS_PCX_EXPORT_SPRITES));
+        else
+            file_str_write(file, str_printf(NULL, "int rooms_pcx_sprite_y[%d] = {", (long)ROOMS_PCX_EXPORT_SPRITES));
+
+        for (i = 0; i < ROOMS_PCX_EXPORT_SPRITES; i++)
+        {
+            int sprite = rooms_pcx_export_sprite[i];
+            int corner = (sprite % ROOMS_PCX_EXPORT_COLUMNS) * ROOMS_PCX_EXPORT_SPRITE_SIZE;
+            if (axis == 1)
+                corner = (sprite / ROOMS_PCX_EXPORT_COLUMNS) * ROOMS_PCX_EXPORT_SPRITE_SIZE;
+
+            if (i > 0)
+                file_str_write(file, ", ");
+
+            file_str_write(file, str_printf(NULL, "%d", (long)corner));
+        }
+
+        file_str_write(file, "};\n");
+    }
+
+    file_str_write(file, "\n// pixels as 0xRRGGBB, row by row\n");
+    file_str_write(file, str_printf(NULL, "int rooms_pcx_pixels[%d] = {\n", (long)(width * height)));
+
+    var format = bmap_lock(pcx, 0);
+
+    int x = 0, y = 0, count = 0;
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            VECTOR color;
+            var alpha = 0;
+            pixel_to_vec(&color, &alpha, format, pixel_for_bmap(pcx, x, y));
+
+            // colors are blue, green, red
+            int rgb = ((int)color.z << 16) | ((int)color.y << 8) | (int)color.x;
+
+            if ((count % 16) == 0)
+                file_str_write(file, "    ");
+            else
+                file_str_write(file, " ");
+
+            file_str_write(file, str_printf(NULL, "0x%06X", (long)rgb));
+            count++;
+
+            if (count < width * height)
+                file_str_write(file, ",");
+
+            if ((count % 16) == 0 || count >= width * height)
+                file_str_write(file, "\n");
+        }
+    }
+
+    bmap_unlock(pcx);
+
+    file_str_write(file, "};\n");
+    file_close(file);
+}
+
+// the old way, 16 sprite bitmaps blitted out of the loaded file
+double rooms_pcx_export_time_file()
+{
+    dtimer();
+
+    BMAP *pcx = bmap_create("rooms.pcx");
+    BMAP *sprites[ROOMS_PCX_EXPORT_SPRITES];
+
+    int i = 0;
+    for (i = 0; i < ROOMS_PCX_EXPORT_SPRITES; i++)
+    {
+        int x = (i % ROOMS_PCX_EXPORT_COLUMNS) * ROOMS_PCX_EXPORT_SPRITE_SIZE;
+        int y = (i / ROOMS_PCX_EXPORT_COLUMNS) * ROOMS_PCX_EXPORT_SPRITE_SIZE;
+        sprites[i] = bmap_createblack(ROOMS_PCX_EXPORT_SPRITE_SIZE * 2, ROOMS_PCX_EXPORT_SPRITE_SIZE * 2, 8888);
+        bmap_blitpart(sprites[i], pcx, NULL, NULL, vector(x, y, 0), vector(ROOMS_PCX_EXPORT_SPRITE_SIZE, ROOMS_PCX_EXPORT_SPRITE_SIZE, 0));
+    }
+
+    double elapsed = dtimer();
+
+    for (i = 0; i < ROOMS_PCX_EXPORT_SPRITES; i++)
+        safe_remove(sprites[i]);
+
+    safe_remove(pcx);
+    return elapsed;
+}
+
+// single atlas made from the compiled in pixels
+double rooms_pcx_export_time_embedded()
+{
+    dtimer();
+
+    room_sprites_create();
+    double elapsed = dtimer();
+
+    room_sprites_destroy();
+    return elapsed;
+}
+
+void rooms_pcx_export_time()
+{
+    int run = 0;
+    for (run = 0; run < ROOMS_PCX_EXPORT_RUNS; run++)
+    {
+        double file_time = rooms_pcx_export_time_file();
+        double embedded_time = rooms_pcx_export_time_embedded();
+
+        if (run == 0)
+        {
+            rooms_pcx_export_file_first = file_time;
+            rooms_pcx_export_embedded_first = embedded_time;
+        }
+
+        rooms_pcx_export_file_average += file_time / ROOMS_PCX_EXPORT_RUNS;
+        rooms_pcx_export_embedded_average += embedded_time / ROOMS_PCX_EXPORT_RUNS;
+    }
+
+    var file = file_open_write("rooms_pcx_timing.txt");
+    if (!file)
+        return;
+
+    file_str_write(file, str_printf(NULL, "runs=%d;\n", (long)ROOMS_PCX_EXPORT_RUNS));
+    file_str_write(file, str_printf(NULL, "file + 16 sprites: first=%.1fus; average=%.1fus;\n", (double)rooms_pcx_export_file_first,
+                                     (double)rooms_pcx_export_file_average));
+    file_str_write(file, str_printf(NULL, "embedded atlas: first=%.1fus; average=%.1fus;\n", (double)rooms_pcx_export_embedded_first,
+                                     (double)rooms_pcx_export_embedded_average));
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    BMAP *pcx = bmap_create("rooms.pcx");
+    if (!pcx)
+        return;
+
+    rooms_pcx_export_write(pcx);
+    safe_remove(pcx);
+
+    rooms_pcx_export_time();
+
+    while (!key_esc)
+    {
+        draw_text("done, rooms_pcx.c and rooms_pcx_timing.txt are written", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
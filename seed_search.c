@@ -0,0 +1,102 @@
+#include <acknex.h>
+#include <default.c>
+
+#define PRAGMA_POINTER
+
+#include "vector2d.c"
+
+#include "map.c"
+
+// finds SEED_SEARCH_HITS seeds of SEED_SEARCH_LEVEL with a shop next to the start room, the boss room at least SEED_SEARCH_BOSS_DEPTH doors away
+// and a secret room next to an item room (see map_search.c), then writes them into seed_search.txt
+// together with seeds searched per second and how many seeds were dropped after each stage
+#define SEED_SEARCH_LEVEL 5
+#define SEED_SEARCH_FIRST_SEED 1
+#define SEED_SEARCH_HITS 16
+#define SEED_SEARCH_BOSS_DEPTH 7
+
+// time the search may take out of every frame (in microseconds)
+#define SEED_SEARCH_BUDGET 10000
+
+char *seed_search_stage_name(int stage)
+{
+    switch (stage)
+    {
+    case MAP_JOB_ROOMS:
+        return "rooms";
+
+    case MAP_JOB_END_ROOMS:
+        return "end rooms";
+
+    case MAP_JOB_SPECIAL_ROOMS:
+        return "special rooms";
+
+    case MAP_JOB_SECRETS:
+        return "secrets";
+
+    case MAP_JOB_SECRET_ROOMS:
+        return "secret rooms";
+    }
+
+    return "none";
+}
+
+void seed_search_write(MapSearch *search)
+{
+    var file = file_open_write("seed_search.txt");
+    if (!file)
+        return;
+
+    file_str_write(file, str_printf(NULL, "level=%d;\nsearched=%d;\nfound=%d;\nseeds/sec=%.1f;\n", (long)search->level_id, (long)search->searched,
+                                     (long)search->hits_count, (double)map_search_rate(search)));
+
+    file_str_write(file, str_printf(NULL, "retried=%d;\n", (long)search->retried));
+    file_str_write(file, "\ndropped after stage:\n");
+
+    int i = 0;
+    for (i = MAP_JOB_ROOMS; i < MAP_JOB_DONE; i++)
+        file_str_write(file, str_printf(NULL, "%s=%d;\n", seed_search_stage_name(i), (long)search->dropped[i]));
+
+    file_str_write(file, "\nseeds:\n");
+    for (i = 0; i < search->hits_count; i++)
+        file_str_write(file, str_printf(NULL, "%d\n", (long)search->hits[i]));
+
+    file_close(file);
+}
+
+void main()
+{
+    fps_max = 60;
+    warn_level = 6;
+
+    wait(1);
+
+    map_init();
+
+    MapSearch *search = &map_search;
+    map_search_begin(search, SEED_SEARCH_LEVEL, SEED_SEARCH_FIRST_SEED, SEED_SEARCH_HITS);
+    map_search_add(search, MAP_PREDICATE_SHOP_NEXT_TO_START, 0);
+    map_search_add(search, MAP_PREDICATE_BOSS_DEPTH, SEED_SEARCH_BOSS_DEPTH);
+    map_search_add(search, MAP_PREDICATE_SECRET_NEXT_TO_ITEM, 0);
+
+    while (!map_search_step(search, SEED_SEARCH_BUDGET))
+    {
+        draw_text(str_printf(NULL, "searched=%d;\nfound=%d/%d;\nseeds/sec=%d;", (long)search->searched, (long)search->hits_count, (long)search->wanted_hits,
+                             (long)map_search_rate(search)),
+                  10, 10, COLOR_RED);
+        wait(1);
+
+        if (key_esc)
+            return;
+    }
+
+    seed_search_write(search);
+
+    while (!key_esc)
+    {
+        draw_text("done, seed_search.txt is written", 10, 10, COLOR_RED);
+        wait(1);
+    }
+
+    sys_exit(NULL);
+}
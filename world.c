@@ -0,0 +1,368 @@
+// endless world made of floor sized chunks, every chunk is a normal floor grown from a seed derived from it's coordinates
+// neighbouring chunks are connected through a gate on their shared edge, gate only depends on the edge itself
+// so every chunk can be (re)generated on it's own and always comes out the same
+
+// chunks around the player that are kept ready (1 = 3x3 chunks)
+#define WORLD_PREFETCH_RADIUS 1
+
+// world_prefetch generates at most this many chunks per call
+#define WORLD_PREFETCH_PER_CALL 1
+
+// edges of a chunk
+#define WORLD_EDGE_HORIZONTAL 0
+#define WORLD_EDGE_VERTICAL 1
+
+typedef struct WorldChunk
+{
+    int x;
+    int y;
+
+    // false for free cache slots
+    int used;
+
+    // world tick of the last access (least recently used chunk is evicted first)
+    int last_used;
+
+    Floor floor;
+} WorldChunk;
+
+// cache of generated chunks, limited by a memory budget
+typedef struct World
+{
+    int seed;
+    int level_id;
+    int tick;
+
+    int capacity;
+    WorldChunk *chunks;
+
+    int hits;
+    int generated;
+    int evicted;
+} World;
+
+// position of the player (or anything else) in the world
+typedef struct WorldPosition
+{
+    int chunk_x;
+    int chunk_y;
+    int cell;
+} WorldPosition;
+
+World *world_create(int seed, int level, int budget_bytes)
+{
+    World *world = sys_malloc(sizeof(World));
+    if (!world)
+        return NULL;
+
+    memset(world, 0, sizeof(World));
+    world->seed = seed;
+    world->level_id = level;
+
+    // whole prefetched area has to fit, no matter how small the budget is
+    int radius_size = WORLD_PREFETCH_RADIUS * 2 + 1;
+    world->capacity = maxv(budget_bytes / sizeof(WorldChunk), radius_size * radius_size + 1);
+    world->chunks = sys_malloc(sizeof(WorldChunk) * world->capacity);
+    if (!world->chunks)
+    {
+        sys_free(world);
+        return NULL;
+    }
+
+    memset(world->chunks, 0, sizeof(WorldChunk) * world->capacity);
+    return world;
+}
+
+void world_destroy(World *world)
+{
+    if (!world)
+        return;
+
+    sys_free(world->chunks);
+    sys_free(world);
+}
+
+int world_chunk_seed(World *world, int x, int y)
+{
+    return hash_mix(world->seed ^ hash_mix(x * 0x27D4EB2F ^ hash_mix(y + 0x165667B1)));
+}
+
+// gate position on the top (horizontal) or left (vertical) edge of the given chunk, never in a corner
+int world_edge_gate(World *world, int x, int y, int edge)
+{
+    unsigned long h = hash_mix(world_chunk_seed(world, x, y) ^ (0x85EBCA6B * (edge + 1)));
+    if (edge == WORLD_EDGE_HORIZONTAL)
+        return 1 + (h >> 8) % (MAP_WIDTH - 2);
+
+    return 1 + (h >> 8) % (MAP_HEIGHT - 2);
+}
+
+int is_world_gate_target(Tile *tile)
+{
+    if (!tile)
+        return false;
+
+    return tile->type == ROOM_NORMAL || tile->type == ROOM_START;
+}
+
+int world_carve_parent[FLOOR_CELLS];
+int world_carve_queue[FLOOR_CELLS];
+
+// connects map cell on the chunk's edge with the layout, n is the edge's cardinal direction
+// corridor takes the shortest way through empty cells to the closest normal room (or the start room)
+void world_carve_gate(int gate_x, int gate_y, int n)
+{
+    Tile *gate = &map[gate_x][gate_y];
+    if (gate->type == ROOM_NONE)
+    {
+        int cell = 0;
+        for (cell = 0; cell < FLOOR_CELLS; cell++)
+            world_carve_parent[cell] = -1;
+
+        int head = 0, tail = 0, found = -1, found_dir = -1;
+        int start = floor_cell(gate_x, gate_y);
+        world_carve_queue[tail] = start;
+        world_carve_parent[start] = start;
+        tail++;
+
+        while (head < tail && found < 0)
+        {
+            cell = world_carve_queue[head];
+            head++;
+
+            int i = 0;
+            for (i = 0; i < CARDINAL_DIRECTIONS; i++)
+            {
+                int neighbour = floor_neighbour_cell(cell, i);
+                if (neighbour < 0)
+                    continue;
+
+                Tile *tile = &map[neighbour % MAP_WIDTH][neighbour / MAP_WIDTH];
+                if (is_world_gate_target(tile))
+                {
+                    found = cell;
+                    found_dir = (i + 2) % CARDINAL_DIRECTIONS;
+                    break;
+                }
+
+                if (tile->type != ROOM_NONE || world_carve_parent[neighbour] >= 0)
+                    continue;
+
+                world_carve_parent[neighbour] = cell;
+                world_carve_queue[tail] = neighbour;
+                tail++;
+            }
+        }
+
+        // layout can't be reached, gate stays closed on this side
+        if (found < 0)
+            return;
+
+        // grow the corridor from the layout back to the gate
+        int room = floor_neighbour_cell(found, (found_dir + 2) % CARDINAL_DIRECTIONS);
+        map_add_room_next_to(&map[room % MAP_WIDTH][room / MAP_WIDTH], &map[found % MAP_WIDTH][found / MAP_WIDTH], found_dir);
+
+        cell = found;
+        while (cell != start)
+        {
+            int parent = world_carve_parent[cell];
+
+            int i = 0;
+            for (i = 0; i < CARDINAL_DIRECTIONS; i++)
+            {
+                if (floor_neighbour_cell(cell, i) == parent)
+                    break;
+            }
+
+            map_add_room_next_to(&map[cell % MAP_WIDTH][cell / MAP_WIDTH], &map[parent % MAP_WIDTH][parent / MAP_WIDTH], i);
+            cell = parent;
+        }
+    }
+
+    // door through the edge, gate that lands on a special room just opens into it
+    gate->doors++;
+    switch (n)
+    {
+    case CARDINAL_TOP:
+        gate->top = true;
+        break;
+
+    case CARDINAL_RIGHT:
+        gate->right = true;
+        break;
+
+    case CARDINAL_BOTTOM:
+        gate->bottom = true;
+        break;
+
+    case CARDINAL_LEFT:
+        gate->left = true;
+        break;
+    }
+}
+
+// generates chunk into the given floor, result only depends on world's seed, level and chunk's coordinates
+void world_chunk_generate(World *world, int x, int y, Floor *floor)
+{
+    map_generate_level(world_chunk_seed(world, x, y), world->level_id);
+
+    world_carve_gate(world_edge_gate(world, x, y, WORLD_EDGE_HORIZONTAL), 0, CARDINAL_TOP);
+    world_carve_gate(MAP_WIDTH - 1, world_edge_gate(world, x + 1, y, WORLD_EDGE_VERTICAL), CARDINAL_RIGHT);
+    world_carve_gate(world_edge_gate(world, x, y + 1, WORLD_EDGE_HORIZONTAL), MAP_HEIGHT - 1, CARDINAL_BOTTOM);
+    world_carve_gate(0, world_edge_gate(world, x, y, WORLD_EDGE_VERTICAL), CARDINAL_LEFT);
+
+    map_floor_save(floor);
+}
+
+WorldChunk *world_find_chunk(World *world, int x, int y)
+{
+    int i = 0;
+    for (i = 0; i < world->capacity; i++)
+    {
+        WorldChunk *chunk = &world->chunks[i];
+        if (chunk->used && chunk->x == x && chunk->y == y)
+            return chunk;
+    }
+
+    return NULL;
+}
+
+// free slot, or the least recently used chunk if the cache is full
+WorldChunk *world_free_chunk(World *world)
+{
+    WorldChunk *oldest = &world->chunks[0];
+
+    int i = 0;
+    for (i = 0; i < world->capacity; i++)
+    {
+        WorldChunk *chunk = &world->chunks[i];
+        if (!chunk->used)
+            return chunk;
+
+        if (chunk->last_used < oldest->last_used)
+            oldest = chunk;
+    }
+
+    world->evicted++;
+    return oldest;
+}
+
+// returns floor of the given chunk, it's generated first if it isn't in the cache
+// returned floor stays valid until the next chunk is generated (it might evict this one)
+Floor *world_chunk(World *world, int x, int y)
+{
+    if (!world)
+        return NULL;
+
+    world->tick++;
+
+    WorldChunk *chunk = world_find_chunk(world, x, y);
+    if (chunk)
+    {
+        world->hits++;
+        chunk->last_used = world->tick;
+        return &chunk->floor;
+    }
+
+    chunk = world_free_chunk(world);
+    chunk->x = x;
+    chunk->y = y;
+    chunk->used = true;
+    chunk->last_used = world->tick;
+
+    world_chunk_generate(world, x, y, &chunk->floor);
+    world->generated++;
+    return &chunk->floor;
+}
+
+// keeps chunks around the given one ready, call it every frame with the player's chunk
+// returns amount of chunks that were generated
+int world_prefetch(World *world, int x, int y)
+{
+    if (!world)
+        return 0;
+
+    int generated = 0;
+
+    int i = 0, j = 0;
+    for (j = -WORLD_PREFETCH_RADIUS; j <= WORLD_PREFETCH_RADIUS; j++)
+    {
+        for (i = -WORLD_PREFETCH_RADIUS; i <= WORLD_PREFETCH_RADIUS; i++)
+        {
+            WorldChunk *chunk = world_find_chunk(world, x + i, y + j);
+            if (chunk)
+            {
+                // close chunks stay the most recently used ones
+                chunk->last_used = world->tick;
+                continue;
+            }
+
+            if (generated >= WORLD_PREFETCH_PER_CALL)
+                continue;
+
+            world_chunk(world, x + i, y + j);
+            generated++;
+        }
+    }
+
+    return generated;
+}
+
+// moves position through the door in the given cardinal direction, crossing into the next chunk at the edges
+// returns false if there is no door that way
+int world_move(World *world, WorldPosition *pos, int n)
+{
+    if (!world || !pos)
+        return false;
+
+    Floor *floor = world_chunk(world, pos->chunk_x, pos->chunk_y);
+    int doors = floor->doors[pos->cell];
+    doors |= (doors >> DOOR_SECRET_SHIFT) | floor->links[pos->cell];
+    if (!(doors & (1 << n)))
+        return false;
+
+    int next = floor_neighbour_cell(pos->cell, n);
+    if (next >= 0)
+    {
+        pos->cell = next;
+        return true;
+    }
+
+    int x = pos->cell % MAP_WIDTH;
+    int y = pos->cell / MAP_WIDTH;
+    int chunk_x = pos->chunk_x;
+    int chunk_y = pos->chunk_y;
+
+    switch (n)
+    {
+    case CARDINAL_TOP:
+        chunk_y--;
+        y = MAP_HEIGHT - 1;
+        break;
+
+    case CARDINAL_RIGHT:
+        chunk_x++;
+        x = 0;
+        break;
+
+    case CARDINAL_BOTTOM:
+        chunk_y++;
+        y = 0;
+        break;
+
+    case CARDINAL_LEFT:
+        chunk_x--;
+        x = MAP_WIDTH - 1;
+        break;
+    }
+
+    // other side has to have the gate open too
+    Floor *next_floor = world_chunk(world, chunk_x, chunk_y);
+    if (!(next_floor->doors[floor_cell(x, y)] & (1 << ((n + 2) % CARDINAL_DIRECTIONS))))
+        return false;
+
+    pos->chunk_x = chunk_x;
+    pos->chunk_y = chunk_y;
+    pos->cell = floor_cell(x, y);
+    return true;
+}